@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Toroidal universe packed 64 cells per word, cell x of a row living in bit x % 64 of word x / 64.
+// Every row carries one guard word on each side, so kernels can read words -1 and `words()` of any row
+// without special-casing the wrap; fillHalo() refreshes them from the opposite edge.
+class BitGrid {
+public:
+    BitGrid() = default;
+    BitGrid(int width, int height);
+
+    int width() const {
+        return _width;
+    }
+    int height() const {
+        return _height;
+    }
+    // Words holding actual cells in each row
+    int words() const {
+        return _words;
+    }
+    // Distance between two rows, guard words included
+    int stride() const {
+        return _words + 2;
+    }
+
+    uint64_t* row(int y) {
+        return _data.data() + static_cast<size_t>(y) * stride() + 1;
+    }
+    const uint64_t* row(int y) const {
+        return _data.data() + static_cast<size_t>(y) * stride() + 1;
+    }
+    // Mask of the bits of the last word of a row that hold cells
+    uint64_t lastWordMask() const {
+        return _last_mask;
+    }
+
+    bool get(int x, int y) const {
+        return row(y)[x >> 6] >> (x & 63) & 1;
+    }
+    void set(int x, int y, bool alive) {
+        uint64_t bit = uint64_t(1) << (x & 63);
+        if (alive) {
+            row(y)[x >> 6] |= bit;
+        } else {
+            row(y)[x >> 6] &= ~bit;
+        }
+    }
+
+    void clear();
+    uint64_t population() const;
+
+    // 64 cells of row y starting at x, wrapping around the row as many times as needed
+    uint64_t fetch(int y, int64_t x) const;
+    // Copies the opposite edges of every row into its guard words and the unused bits of its last word
+    void fillHalo();
+    void fillHalo(int y);
+    // Zeroes the unused bits of the last word of every row
+    void maskPadding();
+    // Copies `source` with its top left corner at (x, y), what falls outside of this grid being cropped. Cells
+    // outside of `source` are left as they are.
+    void paste(const BitGrid& source, int x, int y);
+
+private:
+    int _width = 0;
+    int _height = 0;
+    int _words = 0;
+    uint64_t _last_mask = 0;
+    std::vector<uint64_t> _data;
+};
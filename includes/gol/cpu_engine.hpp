@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "gol/bit_grid.hpp"
+#include "gol/rules.hpp"
+#include "gol/thread_pool.hpp"
+
+struct CpuEngineOptions {
+    // Worker threads, 0 for one per hardware thread
+    int threads = 0;
+    // Side of the square tiles stepped in parallel, in cells (widths are rounded up to whole 64-cell words)
+    int tile_size = 256;
+    // Only recompute tiles that changed, or had a neighbor change, during the previous pass
+    bool skip_stable_tiles = true;
+    // Generations advanced per pass over each tile, from 1 to 63. Above 1, every tile is copied to a local
+    // buffer along with a halo that wide and stepped there, so the grid is streamed once per pass instead
+    // of once per generation.
+    int temporal_steps = 1;
+};
+
+// Headless simulation on a bit-packed torus, following the same rules and wrap as gol.comp
+class CpuEngine {
+public:
+    CpuEngine(int width, int height, const CpuEngineOptions& options = {});
+
+    int width() const {
+        return _current.width();
+    }
+    int height() const {
+        return _current.height();
+    }
+    uint64_t generation() const {
+        return _generation;
+    }
+    int threads() const {
+        return _pool->size();
+    }
+    int tileSize() const {
+        return _tile_rows;
+    }
+    // In cells, tileSize() rounded up to whole words
+    int tileWidth() const {
+        return _tile_words * 64;
+    }
+    int tileCount() const {
+        return _tiles_x * _tiles_y;
+    }
+    int temporalSteps() const {
+        return _temporal_steps;
+    }
+
+    void setRules(const int rules[RULE_COUNT]);
+    const RuleMasks& rules() const {
+        return _rules;
+    }
+
+    void step(int generations = 1);
+    // Throughput of the last step() call
+    double cellsPerSecond() const {
+        return _cells_per_second;
+    }
+    // Fraction of the tiles the last step() call did not have to recompute
+    double skippedFraction() const {
+        return _skipped_fraction;
+    }
+
+    bool getCell(int x, int y) const {
+        return _current.get(x, y);
+    }
+    void setCell(int x, int y, bool alive) {
+        _current.set(x, y, alive);
+        _edited = true;
+    }
+    void clear();
+    uint64_t population() const {
+        return _current.population();
+    }
+
+    // Conversions from and to the one float per cell layout of the state textures
+    void loadCells(const std::vector<float>& cells);
+    std::vector<float> storeCells() const;
+    // The random soup soupRow() draws from `seed`, filled in parallel straight into the packed grid
+    void loadSoup(uint64_t seed, uint32_t threshold);
+
+    const BitGrid& grid() const {
+        return _current;
+    }
+    BitGrid& grid() {
+        _edited = true;
+        return _current;
+    }
+
+private:
+    void stepTile(int tile, int steps);
+    bool neighborhoodChanged(int tile) const;
+    // Both step rows [row_begin, row_end) of `words` words from word_begin into _next and return the bits
+    // that differ from _current
+    uint64_t stepRows(int row_begin, int row_end, int word_begin, int words);
+    uint64_t stepBlock(int row_begin, int row_end, int word_begin, int words, int steps);
+    bool canSkip(int steps) const;
+
+    BitGrid _current;
+    BitGrid _next;
+    RuleMasks _rules;
+    uint64_t _generation = 0;
+    double _cells_per_second = 0;
+    double _skipped_fraction = 0;
+
+    std::unique_ptr<ThreadPool> _pool;
+    int _tile_rows = 0;
+    int _tile_words = 0;
+    int _tiles_x = 0;
+    int _tiles_y = 0;
+    int _temporal_steps = 1;
+    // Tiles of each row band still running this pass, the last one to finish fills the band's guard words
+    std::unique_ptr<std::atomic<int>[]> _band_pending;
+
+    // Per tile: did its cells change during the last pass, and during the one being computed.
+    // A tile left alone has the same cells in both buffers, so skipping it needs no copy.
+    bool _skip_stable_tiles = true;
+    bool _edited = true;
+    // Skipping only holds between passes of the same length
+    int _last_pass_steps = 0;
+    std::vector<uint8_t> _changed;
+    std::vector<uint8_t> _next_changed;
+    std::atomic<int> _skipped_tiles = 0;
+};
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gol/bit_grid.hpp"
+#include "gol/rules.hpp"
+
+// Unbounded universe as a hash-consed quadtree, stepped with memoized RESULT nodes so a node of level L
+// jumps up to 2^(L-2) generations in one go. Nodes live in a budgeted store: when it fills up, everything
+// unreachable from the current pattern (memoized results included) is garbage collected.
+//
+// The universe is infinite rather than a torus, so rules where no neighbors means birth (rules[0] == 1)
+// are rejected.
+class HashLife {
+public:
+    using NodeId = uint32_t;
+
+    static constexpr NodeId DEAD = 0;
+    static constexpr NodeId ALIVE = 1;
+    static constexpr int MAX_LEVEL = 62;
+    // Smaller budgets are raised to this, the hash table alone starts at a quarter of it
+    static constexpr size_t MIN_MEMORY_BUDGET = size_t(1) << 20;
+
+    explicit HashLife(const int rules[RULE_COUNT], size_t memory_budget = size_t(1) << 30);
+
+    void setRules(const int rules[RULE_COUNT]);
+    const RuleMasks& rules() const {
+        return _rules;
+    }
+
+    // Bytes the node store may use before collecting garbage, at least MIN_MEMORY_BUDGET. A target rather than a cap:
+    // when the pattern and the step in progress need more, the store grows past it.
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const {
+        return _memory_budget;
+    }
+    size_t memoryUsage() const;
+    size_t nodeCount() const {
+        return _live_nodes;
+    }
+    size_t collections() const {
+        return _collections;
+    }
+
+    bool getCell(int64_t x, int64_t y) const;
+    void setCell(int64_t x, int64_t y, bool alive);
+    void clear();
+    uint64_t population() const;
+    uint64_t generation() const {
+        return _generation;
+    }
+    void setGeneration(uint64_t generation) {
+        _generation = generation;
+    }
+    // Smallest rectangle [left, right) x [top, bottom) holding every live cell, false when there are none
+    bool bounds(int64_t& left, int64_t& top, int64_t& right, int64_t& bottom) const;
+
+    // Copies a torus into the universe with its cell (0, 0) at (x, y), and back
+    void loadGrid(const BitGrid& grid, int64_t x = 0, int64_t y = 0);
+    void storeGrid(BitGrid& grid, int64_t x = 0, int64_t y = 0) const;
+
+    // Advances `generations` generations, as a sum of power of two jumps
+    void step(uint64_t generations);
+    // Advances 2^k generations
+    void stepPow2(int k);
+
+    // Canonical node access, for pattern formats storing quadtrees directly
+    NodeId root() const {
+        return _root;
+    }
+    int rootLevel() const {
+        return level(_root);
+    }
+    // Replaces the universe by a node, centered on the origin
+    void setRoot(NodeId node);
+    NodeId join(NodeId nw, NodeId ne, NodeId sw, NodeId se);
+    NodeId empty(int level) const {
+        return _empty[level];
+    }
+    int level(NodeId node) const {
+        return _nodes[node].level;
+    }
+    NodeId child(NodeId node, int quadrant) const {
+        const Node& n = _nodes[node];
+        return quadrant == 0 ? n.nw : quadrant == 1 ? n.ne : quadrant == 2 ? n.sw : n.se;
+    }
+
+private:
+    static constexpr NodeId NONE = UINT32_MAX;
+    static constexpr uint8_t FREE = 0xFF;
+
+    struct Node {
+        NodeId nw = NONE, ne = NONE, sw = NONE, se = NONE;
+        NodeId result = NONE;
+        // Next node of the same hash bucket, or of the free list
+        NodeId next = NONE;
+        uint8_t level = 0;
+        bool marked = false;
+    };
+
+    NodeId allocate();
+    void rehash(size_t buckets);
+    size_t bucketOf(NodeId nw, NodeId ne, NodeId sw, NodeId se) const;
+
+    NodeId result(NodeId node);
+    NodeId baseResult(NodeId node);
+    NodeId centered(NodeId node);
+    NodeId expand(NodeId node);
+    bool borderIsEmpty(NodeId node) const;
+    NodeId setCell(NodeId node, int level, int64_t x, int64_t y, bool alive);
+    NodeId build(const BitGrid& grid, int level, int64_t x, int64_t y, int64_t offset_x, int64_t offset_y);
+    void store(NodeId node, int level, int64_t x, int64_t y, BitGrid& grid, int64_t offset_x, int64_t offset_y) const;
+
+    void clearResults();
+    void maybeCollect();
+    void collect();
+    // Frees everything unreachable from the pattern, the recursion and the memoized results of what is kept
+    void sweep();
+    void mark(NodeId node);
+
+    RuleMasks _rules;
+    std::vector<Node> _nodes;
+    std::vector<NodeId> _buckets;
+    std::vector<NodeId> _empty;
+    NodeId _free = NONE;
+    size_t _live_nodes = 0;
+
+    // Nodes the recursion is still working with, so a collection in the middle of a step keeps them
+    std::vector<NodeId> _stack;
+    NodeId _root = DEAD;
+    int _result_step = -1;
+    uint64_t _generation = 0;
+
+    size_t _memory_budget = 0;
+    size_t _collect_threshold = 0;
+    size_t _collections = 0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Images read one row at a time, never decoded whole: binary PBM (P4), PGM (P5) and PPM (P6), uncompressed BMP, and
+// non-interlaced PNG when built with libpng (GOL_HAVE_PNG). Rows come out as one byte per pixel, the gray level or
+// the red channel as stb_image decodes them first, so they threshold to the same cells as loadImage(). Unsupported
+// or malformed files throw std::runtime_error.
+class ImageStream {
+public:
+    explicit ImageStream(const std::string& path);
+    ~ImageStream();
+    ImageStream(ImageStream&& other) noexcept;
+    ImageStream& operator=(ImageStream&& other) noexcept;
+
+    // Whether the file's extension is one of the streamed formats
+    static bool supports(const std::string& path);
+
+    int width() const;
+    int height() const;
+    // Rows come in file order, which is bottom to top for most BMP files
+    bool bottomUp() const;
+    // The next row, width() bytes
+    void readRow(uint8_t* pixels);
+
+    struct Decoder;
+
+private:
+    std::unique_ptr<Decoder> _decoder;
+};
+
+// Rows [y, y + rows) of a universe, as BitGrid rows without their guard words
+struct ImageBand {
+    int y = 0;
+    int rows = 0;
+    int words = 0;
+    std::vector<uint64_t> bits;
+};
+
+// Decodes and thresholds an image on a worker thread, non-zero pixels being alive, into bands of a width x height
+// universe with the image centered on it and cropped. The worker stays at most `queue_bands` bands ahead of next(),
+// so only a few bands are ever in memory whatever the size of the image.
+class ImageBandReader {
+public:
+    ImageBandReader(ImageStream stream, int width, int height, int band_rows = 256, int queue_bands = 2);
+    ~ImageBandReader();
+
+    ImageBandReader(const ImageBandReader&) = delete;
+    ImageBandReader& operator=(const ImageBandReader&) = delete;
+
+    // Moves the next band to `band`, waiting for it when `wait` is set. False when none is ready yet, or when every
+    // band has been taken; decoding errors are thrown from here.
+    bool next(ImageBand& band, bool wait);
+    // Every band has been taken
+    bool finished();
+
+private:
+    void decode();
+
+    ImageStream _stream;
+    int _width;
+    int _height;
+    int _band_rows;
+    size_t _queue_bands;
+
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::deque<ImageBand> _bands;
+    bool _done = false;
+    bool _stop = false;
+    std::exception_ptr _error;
+    std::thread _worker;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+
+#include "gol/rules.hpp"
+
+// Instruction sets stepRow can run on, from narrowest to widest
+enum class KernelIsa {
+    Scalar,
+    Sse2,
+    Avx2,
+    Avx512,
+};
+
+// Widest instruction set both this binary and the running CPU support
+KernelIsa detectKernelIsa();
+// Instruction set picked at startup, or forced through setKernelIsa()
+KernelIsa kernelIsa();
+// Forces a narrower instruction set, mostly for benchmarking; falls back to the widest supported one
+void setKernelIsa(KernelIsa isa);
+const char* kernelIsaName(KernelIsa isa);
+
+// Computes one generation of `words` packed words of a row from the rows above and below it.
+// The input rows must be readable at index -1 and `words` (BitGrid guard words).
+void stepRow(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words, const RuleMasks& rules
+);
+
+// Row y of a random soup, packed like BitGrid rows: cell x is alive when 16-bit lane x % 8 of the Philox4x32-10 block
+// for counter (x / 8, y, 0, 0) and key `seed` is below `threshold`, out of 65536, the same cells as gol_soup.comp and
+// RandomNumberGenerator::soupBlock(). Fills whole words, the caller masks the padding.
+void soupRow(uint64_t seed, uint32_t threshold, uint32_t y, uint64_t* out, int words);
+
+// Bit x set for the non-zero bytes of pixels[0, count), packed like BitGrid rows. Writes (count + 63) / 64 words, the
+// bits past `count` clear.
+void thresholdRow(const uint8_t* pixels, int count, uint64_t* out);
+// Same, or'ed into `row` from cell x on, for images placed anywhere in a grid. The row must be wide enough for them.
+void thresholdRowInto(const uint8_t* pixels, int count, uint64_t* row, int x);
@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "gol/bit_grid.hpp"
+#include "gol/rules.hpp"
+#include "gol/thread_pool.hpp"
+
+// Next state of a 2x2 block from the 4x4 cells around it. Row r of the neighborhood is nibble r of the
+// index, column c bit c of the nibble; bits 0 to 3 of an entry are the top left, top right, bottom left
+// and bottom right cells of the block.
+using BlockTable = std::array<uint8_t, 65536>;
+
+void buildBlockTable(const RuleMasks& rules, BlockTable& table);
+
+// Headless simulation on a bit-packed torus stepped with BlockTable lookups rather than bitwise logic,
+// so its speed does not depend on the rule. Same rules and wrap as gol.comp.
+class LutEngine {
+public:
+    // 0 threads means one per hardware thread
+    LutEngine(int width, int height, int threads = 0);
+
+    int width() const {
+        return _current.width();
+    }
+    int height() const {
+        return _current.height();
+    }
+    uint64_t generation() const {
+        return _generation;
+    }
+    int threads() const {
+        return _pool->size();
+    }
+
+    // Rebuilds the block table
+    void setRules(const int rules[RULE_COUNT]);
+    void setRules(const RuleMasks& rules);
+    const RuleMasks& rules() const {
+        return _rules;
+    }
+
+    void step(int generations = 1);
+    // Throughput of the last step() call
+    double cellsPerSecond() const {
+        return _cells_per_second;
+    }
+
+    bool getCell(int x, int y) const {
+        return _current.get(x, y);
+    }
+    void setCell(int x, int y, bool alive) {
+        _current.set(x, y, alive);
+    }
+    void clear();
+    uint64_t population() const {
+        return _current.population();
+    }
+
+    const BitGrid& grid() const {
+        return _current;
+    }
+    BitGrid& grid() {
+        return _current;
+    }
+
+private:
+    void stepBlockRow(int y);
+
+    BitGrid _current;
+    BitGrid _next;
+    RuleMasks _rules;
+    std::unique_ptr<BlockTable> _table;
+    std::unique_ptr<ThreadPool> _pool;
+    uint64_t _generation = 0;
+    double _cells_per_second = 0;
+};
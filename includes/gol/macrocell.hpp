@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+#include "gol/hashlife.hpp"
+#include "gol/rules.hpp"
+
+// Golly Macrocell files: a "[M2]" line, '#' comment lines ("#R B3/S23" the rule, "#G 1024" the generation), then
+// one quadtree node per line, numbered from 1 in order. A line of '.', '*' and '$' is an 8x8 leaf drawn row by row;
+// "k nw ne sw se" is a node of 2^k cells a side, its children being earlier nodes or 0 for an empty one. The last
+// node is the whole pattern. Repeated subtrees are written once, so a pattern far larger than memory as cells can
+// still be a small file.
+struct MacrocellHeader {
+    // Only when the file names a rule the rule table can express
+    bool has_rule = false;
+    int rules[RULE_COUNT] = {};
+    uint64_t generation = 0;
+};
+
+// HashLife as a plain node store for reading or writing Macrocell files. It is never stepped, so it takes any rule,
+// including the B0 ones HashLife itself cannot run.
+HashLife macrocellStore();
+
+// Joins every node into `life`'s store as soon as its line is read, so identical subtrees are shared from the start
+// and the pattern is never more than its distinct nodes. The pattern replaces the universe, centered on the origin,
+// at the file's generation. Malformed input throws std::runtime_error.
+MacrocellHeader readMacrocell(std::istream& in, HashLife& life);
+
+// Writes each distinct node of the universe once, children before their parents
+void writeMacrocell(std::ostream& out, const HashLife& life, const int rules[RULE_COUNT]);
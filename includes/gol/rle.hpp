@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "gol/bit_grid.hpp"
+#include "gol/rules.hpp"
+
+// Golly / LifeWiki run length encoded patterns: '#' comment lines, a "x = W, y = H, rule = B3/S23" header, then
+// <count><tag> items where b is a dead cell, o (or any other letter, for multi-state files) a live one, $ ends a
+// row and ! the pattern.
+struct RleHeader {
+    int64_t width = 0;
+    int64_t height = 0;
+    // Only when the header names a rule the rule table can express
+    bool has_rule = false;
+    int rules[RULE_COUNT] = {};
+};
+
+// Decodes the runs as they are read, in fixed size chunks, so a pattern never exists as anything larger than the
+// destination grid. Malformed input throws std::runtime_error.
+class RleReader {
+public:
+    // Reads up to and including the header line
+    explicit RleReader(std::istream& in);
+
+    const RleHeader& header() const {
+        return _header;
+    }
+
+    // Calls live(x, y, length) for every run of live cells, in reading order
+    void readRuns(const std::function<void(int64_t x, int64_t y, int64_t length)>& live);
+    // Sets the live cells with the pattern's top left corner at (offset_x, offset_y) of `grid`, without wrapping:
+    // cells falling outside are dropped
+    void readInto(BitGrid& grid, int64_t offset_x, int64_t offset_y);
+
+private:
+    std::istream& _in;
+    RleHeader _header;
+};
+
+// Writes the grid with the header giving its size and rule, 70 characters per line at most
+void writeRle(std::ostream& out, const BitGrid& grid, const int rules[RULE_COUNT]);
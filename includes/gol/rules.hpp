@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Rule table values, as edited by the rule buttons
+constexpr int RULE_DIE = 0;
+constexpr int RULE_BIRTH = 1;
+constexpr int RULE_KEEP = 2;
+
+constexpr int RULE_COUNT = 9;
+
+// rules[9] folded into two neighbor-count bitsets: bit n of `birth` means n neighbors makes the cell live,
+// bit n of `keep` means n neighbors keeps the cell as it is, anything else kills it.
+// The step shaders get the same masks as u_birth and u_keep.
+struct RuleMasks {
+    uint32_t birth = 0;
+    uint32_t keep = 0;
+};
+
+inline RuleMasks compileRules(const int rules[RULE_COUNT]) {
+    RuleMasks masks;
+    for (int i = 0; i < RULE_COUNT; i++) {
+        if (rules[i] == RULE_BIRTH) {
+            masks.birth |= 1u << i;
+        } else if (rules[i] == RULE_KEEP) {
+            masks.keep |= 1u << i;
+        }
+    }
+    return masks;
+}
+
+inline bool applyRule(const RuleMasks& masks, int neighbors, bool alive) {
+    return (masks.birth >> neighbors & 1) || (alive && (masks.keep >> neighbors & 1));
+}
+
+// Rule table from "B3/S23" notation. A count in B is a birth and keeps live cells alive too, so counts in B but not
+// in S (e.g. HighLife's B36/S23) have no rule table equivalent and are rejected.
+inline void parseRule(const std::string& notation, int rules[RULE_COUNT]) {
+    auto slash = notation.find('/');
+    if (slash == std::string::npos || notation.size() < 3 || (notation[0] != 'B' && notation[0] != 'b') ||
+        (notation[slash + 1] != 'S' && notation[slash + 1] != 's')) {
+        throw std::invalid_argument("Expected a rule like B3/S23, got " + notation);
+    }
+    bool birth[RULE_COUNT] = {};
+    bool survive[RULE_COUNT] = {};
+    auto counts = [&](size_t begin, size_t end, bool* set) {
+        for (size_t i = begin; i < end; i++) {
+            if (notation[i] < '0' || notation[i] >= '0' + RULE_COUNT) {
+                throw std::invalid_argument("Expected neighbor counts from 0 to 8 in " + notation);
+            }
+            set[notation[i] - '0'] = true;
+        }
+    };
+    counts(1, slash, birth);
+    counts(slash + 2, notation.size(), survive);
+    for (int i = 0; i < RULE_COUNT; i++) {
+        if (birth[i] && !survive[i]) {
+            throw std::invalid_argument(std::to_string(i) + " is a birth but not a survival count in " + notation);
+        }
+        rules[i] = birth[i] ? RULE_BIRTH : survive[i] ? RULE_KEEP : RULE_DIE;
+    }
+}
+
+// Rule named by a pattern file, in B/S notation or the older S/B one ("23/3"). False, rather than an exception, when
+// the rule table cannot express it, as the file's cells are still usable.
+inline bool parsePatternRule(std::string notation, int rules[RULE_COUNT]) {
+    auto slash = notation.find('/');
+    if (!notation.empty() && notation[0] >= '0' && notation[0] <= '9' && slash != std::string::npos) {
+        notation = "B" + notation.substr(slash + 1) + "/S" + notation.substr(0, slash);
+    }
+    try {
+        parseRule(notation, rules);
+        return true;
+    } catch (const std::invalid_argument&) {
+        return false;
+    }
+}
+
+inline std::string formatRule(const int rules[RULE_COUNT]) {
+    std::string birth = "B";
+    std::string survive = "S";
+    for (int i = 0; i < RULE_COUNT; i++) {
+        if (rules[i] == RULE_BIRTH) {
+            birth += char('0' + i);
+        }
+        if (rules[i] != RULE_DIE) {
+            survive += char('0' + i);
+        }
+    }
+    return birth + "/" + survive;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gol/bit_grid.hpp"
+#include "gol/rules.hpp"
+
+// Versioned binary universe snapshots: a fixed header (size, rule, generation, soup seed), a table of tiles, then the
+// tiles. A tile is a band of SNAPSHOT_TILE_ROWS rows of bit-packed words, laid out as BitGrid rows without their guard
+// words, checksummed, and stored either raw or, when that is smaller, as runs of zero words between literal words.
+// When every tile is raw the cells are a single row-major array in the file, usable in place from a memory mapping.
+constexpr int SNAPSHOT_TILE_ROWS = 256;
+
+struct SnapshotInfo {
+    int width = 0;
+    int height = 0;
+    int rules[RULE_COUNT] = {};
+    uint64_t generation = 0;
+    // Of the soup the universe started from
+    uint64_t seed = 0;
+};
+
+// `rows` holds (width + 63) / 64 words per row, row y starting at rows + y * stride. The bits past the last cell of
+// each row may hold anything. Throws std::runtime_error when the file cannot be written.
+void writeSnapshot(
+    const std::string& path, const SnapshotInfo& info, const uint64_t* rows, size_t stride, bool compress
+);
+
+// Memory mapped snapshot: opening reads the header and the tile table only, cells are paged in as they are used.
+// Malformed files throw std::runtime_error.
+class SnapshotFile {
+public:
+    explicit SnapshotFile(const std::string& path);
+    ~SnapshotFile();
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    const SnapshotInfo& info() const {
+        return _info;
+    }
+    int words() const {
+        return (_info.width + 63) / 64;
+    }
+    int tileCount() const {
+        return static_cast<int>(_tiles.size());
+    }
+
+    // Every row in place, words() apart, when no tile is compressed, null otherwise. Checksums are not verified.
+    const uint64_t* rows() const {
+        return _rows;
+    }
+    // Rows of a tile decoded to `out`, words() apart, throwing when the checksum does not match
+    void readTile(int tile, uint64_t* out) const;
+    // The whole universe into a grid of the same size
+    void readInto(BitGrid& grid) const;
+
+    // Tile table entry, as stored. `checksum` is of the raw words, `size` in bytes as stored.
+    struct Tile {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t checksum = 0;
+        uint32_t codec = 0;
+        uint32_t reserved = 0;
+    };
+
+private:
+    int tileRows(int tile) const;
+
+    SnapshotInfo _info;
+    int _tile_rows = 0;
+    std::vector<Tile> _tiles;
+    const uint64_t* _rows = nullptr;
+    const unsigned char* _data = nullptr;
+    size_t _size = 0;
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gol/bit_grid.hpp"
+#include "gol/rules.hpp"
+
+// Unbounded universe made of 64x64 cell chunks, only the chunks holding live cells being allocated.
+// Chunks come from a pool and are found through an open addressing hash map keyed by chunk coordinates;
+// a chunk that ends up empty after a generation goes back to the pool, so memory follows the live area.
+//
+// Chunks are keyed by 32-bit chunk coordinates, so the universe spans [MIN_COORDINATE, MAX_COORDINATE] on both
+// axes, about 2^37 cells on either side of the origin. setCell() throws std::out_of_range past that, getCell() reads
+// dead cells there, and whatever a pattern sends across the edge is lost, as if the cells beyond were always dead.
+//
+// Like HashLife, rules giving birth with no neighbors (rules[0] == 1) are rejected.
+class SparseUniverse {
+public:
+    static constexpr int CHUNK_SIZE = 64;
+    static constexpr int64_t MIN_COORDINATE = int64_t(INT32_MIN) * CHUNK_SIZE;
+    static constexpr int64_t MAX_COORDINATE = (int64_t(INT32_MAX) + 1) * CHUNK_SIZE - 1;
+
+    explicit SparseUniverse(const int rules[RULE_COUNT]);
+
+    void setRules(const int rules[RULE_COUNT]);
+    const RuleMasks& rules() const {
+        return _rules;
+    }
+
+    bool getCell(int64_t x, int64_t y) const;
+    void setCell(int64_t x, int64_t y, bool alive);
+    void clear();
+    uint64_t population() const;
+    uint64_t generation() const {
+        return _generation;
+    }
+
+    void step(int generations = 1);
+
+    size_t chunkCount() const {
+        return _chunks.size();
+    }
+    size_t memoryUsage() const;
+
+    // Copies a torus into the universe with its cell (0, 0) at (x, y), and back
+    void loadGrid(const BitGrid& grid, int64_t x = 0, int64_t y = 0);
+    void storeGrid(BitGrid& grid, int64_t x = 0, int64_t y = 0) const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Chunk {
+        uint64_t rows[CHUNK_SIZE];
+    };
+
+    // Chunk coordinates -> pool index, linear probing, no deletion: maps are rebuilt every generation
+    class ChunkMap {
+    public:
+        ChunkMap();
+        uint32_t find(uint64_t key) const;
+        // Returns the slot value, inserting `value` first if the key is missing
+        uint32_t& insert(uint64_t key, uint32_t value);
+        void clear();
+        size_t size() const {
+            return _size;
+        }
+        size_t capacity() const {
+            return _keys.size();
+        }
+        template <class F>
+        void forEach(F&& f) const {
+            for (size_t i = 0; i < _keys.size(); i++) {
+                if (_values[i] != NONE) {
+                    f(_keys[i], _values[i]);
+                }
+            }
+        }
+
+    private:
+        void rehash(size_t capacity);
+        size_t slotOf(uint64_t key) const;
+
+        std::vector<uint64_t> _keys;
+        std::vector<uint32_t> _values;
+        size_t _size = 0;
+        size_t _peak = 0;
+    };
+
+    static bool inRange(int64_t chunk_x, int64_t chunk_y) {
+        return chunk_x >= INT32_MIN && chunk_x <= INT32_MAX && chunk_y >= INT32_MIN && chunk_y <= INT32_MAX;
+    }
+    // Only for chunks inRange()
+    static uint64_t keyOf(int64_t chunk_x, int64_t chunk_y) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(chunk_x)) << 32 | static_cast<uint32_t>(chunk_y);
+    }
+    static int64_t chunkX(uint64_t key) {
+        return static_cast<int32_t>(key >> 32);
+    }
+    static int64_t chunkY(uint64_t key) {
+        return static_cast<int32_t>(key);
+    }
+
+    uint32_t allocate();
+    void release(uint32_t chunk);
+    const Chunk* chunkAt(int64_t chunk_x, int64_t chunk_y) const;
+    bool stepChunk(uint64_t key, Chunk& out) const;
+
+    RuleMasks _rules;
+    std::vector<Chunk> _pool;
+    std::vector<uint32_t> _free;
+    ChunkMap _chunks;
+    ChunkMap _next_chunks;
+    ChunkMap _candidates;
+    uint64_t _generation = 0;
+};
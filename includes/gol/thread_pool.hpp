@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join pool: parallelFor() deals task indices out to one deque per thread, every thread drains its own
+// deque from the front and steals from the back of the others once it runs dry. The calling thread takes
+// part in the work, so a pool of size 1 runs everything inline. Tasks never add tasks, so a thread that finds every
+// deque empty is done for the round and goes back to sleep.
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const {
+        return static_cast<int>(_queues.size());
+    }
+
+    // Runs task(i) for every i in [0, count) and returns once all of them are done
+    void parallelFor(int count, const std::function<void(int)>& task);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> items;
+    };
+
+    void workerLoop(int index);
+    void drain(int index);
+    bool pop(int index, int& item);
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    const std::function<void(int)>* _task = nullptr;
+    uint64_t _round = 0;
+    int _busy_workers = 0;
+    bool _stopping = false;
+};
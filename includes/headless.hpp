@@ -0,0 +1,13 @@
+#pragma once
+
+// Batch mode, for machines without a display:
+//   --headless (--in FILE | --soup WIDTHxHEIGHT [--density P] [--seed S]) [--rule B3/S23] [--gens N] [--out FILE]
+//   [--engine cpu|lut|sparse] [--threads N] [--tile-size N] [--compress]
+// Steps the image's cells, an .rle pattern on a universe its size, a .snap snapshot, or the same random soup the GUI
+// makes from that seed, on the CPU, writes the result as a PNG, .rle, .mc or .snap (--compress packing its empty
+// runs) and prints the timing, without creating any window or GL context. A .mc (Macrocell) file steps on HashLife
+// instead, unbounded, and is written as .mc or .rle. --engine lut steps the torus with LutEngine's block table rather
+// than the bit-sliced kernels, --engine sparse steps the input on an unbounded SparseUniverse and writes what ends up
+// inside the input's area. A pattern file's rule applies unless --rule is given. PBM/PGM/PPM, BMP and (with libpng)
+// PNG images are read in bands rather than whole. Returns the process exit code.
+int runHeadless(int argc, const char* argv[]);
@@ -1,12 +1,41 @@
 #pragma once
 #include <GL/gl.h>
 #include <filesystem>
+#include <string>
 #include <vector>
 
-GLuint loadShader(const std::filesystem::path& file, const GLuint& type);
+#include "gol/bit_grid.hpp"
+
+// `defines` is inserted right after the #version line, e.g. "#define TILE_SIZE 16\n"
+GLuint loadShader(const std::filesystem::path& file, const GLuint& type, const std::string& defines = "");
 GLuint loadShaderProgram(const std::filesystem::path& vertex_file, const std::filesystem::path& frament_file);
-GLuint loadComputeProgram(const std::filesystem::path& compute_file);
-std::vector<float> loadImage(const std::filesystem::path& file);
+GLuint loadComputeProgram(const std::filesystem::path& compute_file, const std::string& defines = "");
+// Same, but the linked program is kept in `cache_dir` with glGetProgramBinary and loaded back with glProgramBinary
+// next time, keyed by a hash of the source with its defines and of the driver strings
+GLuint loadCachedComputeProgram(
+    const std::filesystem::path& compute_file, const std::string& defines, const std::filesystem::path& cache_dir
+);
+// One float per cell, 1 for the live ones
+struct CellImage {
+    int width = 0;
+    int height = 0;
+    std::vector<float> cells;
+};
+struct ImageSize {
+    int width = 0;
+    int height = 0;
+};
+// From the file's header, without decoding the pixels
+ImageSize imageSize(const std::filesystem::path& file);
+// Thresholds the image's first channel, gray or red, straight into `grid`, non-zero pixels being alive, the image
+// centered and cropped to fit. Returns the image's actual size. The formats ImageStream reads take one row of bytes
+// besides the grid. Any other format is decoded whole by stb_image: one byte per pixel for gray images, and up to
+// four per pixel for color ones.
+ImageSize loadImage(const std::filesystem::path& file, BitGrid& grid);
+// Grayscale PNG, white for the live cells
+void saveImage(const std::filesystem::path& file, int width, int height, const std::vector<float>& cells);
+// The image centered in a width x height universe, cropped if it does not fit
+std::vector<float> placeImage(const CellImage& image, int width, int height);
 GLuint loadTexture(const std::filesystem::path& file);
 GLuint createTexture(
     int width, int height, GLenum internalformat, GLenum format, GLenum type, const void* data = nullptr
@@ -14,7 +43,15 @@ GLuint createTexture(
 void replaceTexture(
     GLuint texture, int width, int height, GLenum internalformat, GLenum format, GLenum type, const void* data = nullptr
 );
+// Immutable single level storage, to be filled with uploadTexture()
+GLuint createTextureStorage(int width, int height, GLenum internalformat);
+void uploadTexture(GLuint texture, int width, int height, GLenum format, GLenum type, const void* data);
+// Rows [y, y + height) only, `row_length` pixels apart in `data` (0 when they are packed)
+void uploadTextureRows(
+    GLuint texture, int y, int width, int height, int row_length, GLenum format, GLenum type, const void* data
+);
 void reloadTexture(GLuint texture, const std::filesystem::path& file);
 void getTexture(GLuint texture, GLenum format, GLenum type, void* data);
 GLuint createRenderbuffer(int width, int height);
+GLuint createBuffer(GLsizeiptr size, const void* data = nullptr, GLbitfield flags = GL_DYNAMIC_STORAGE_BIT);
 GLuint createFramebuffer(GLuint texture, GLuint renderbuffer = 0);
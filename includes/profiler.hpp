@@ -0,0 +1,51 @@
+#pragma once
+#include <GL/gl.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// CPU and GPU time spent in each phase of the last HISTORY frames. The GPU side is a pair of GL_TIMESTAMP queries
+// per phase, with two sets used in turn so that a frame only reads the queries of the frame before the previous one
+// and never waits on the GPU. Timestamps rather than GL_TIME_ELAPSED because elapsed queries cannot nest and
+// the step already has one of its own.
+class FrameProfiler {
+public:
+    static constexpr int HISTORY = 240;
+
+    explicit FrameProfiler(std::vector<std::string> phases);
+    ~FrameProfiler();
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    void beginFrame();
+    void endFrame();
+    // Phases are indices into the names given to the constructor, at most one begin/end pair each per frame
+    void begin(int phase);
+    void end(int phase);
+
+    // Histograms of the recorded frames with their 50th and 99th percentiles, within the current ImGui window
+    void showUi() const;
+    // One line per recorded frame, oldest first, with the CPU then GPU milliseconds of each phase
+    bool dump(const std::filesystem::path& file) const;
+
+private:
+    struct Phase {
+        std::string name;
+        std::vector<float> cpu_ms = std::vector<float>(HISTORY);
+        std::vector<float> gpu_ms = std::vector<float>(HISTORY);
+        std::chrono::steady_clock::time_point cpu_start;
+        // Begin and end timestamps for each query set, and whether they were issued in that set's last frame
+        GLuint queries[2][2] = {};
+        bool issued[2] = {false, false};
+    };
+
+    // Samples of the frames still in the history whose GPU times are known, oldest first, without the missing ones
+    std::vector<float> samples(const std::vector<float>& history) const;
+
+    std::vector<Phase> _phases;
+    // History entries are indexed by frame % HISTORY, _frame is the one being recorded, and overwrites the oldest
+    // entry. GPU times are known up to _complete excluded, NaN when their queries were not done in time.
+    long _frame = 0;
+    long _complete = 0;
+};
@@ -1,17 +1,57 @@
 #pragma once
-#include <random>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 
+// Philox4x32-10 (Salmon et al., Random123): every block of four words is a pure function of a 128-bit counter and
+// the 64-bit seed, so any range of draws can be generated on its own, by any thread and in any order, with the same
+// result. Soups follow gol_soup.comp bit for bit.
 class RandomNumberGenerator {
 public:
-    RandomNumberGenerator() : dev(), rng(dev()), dist(0, 1) {
+    using Block = std::array<uint32_t, 4>;
+
+    explicit RandomNumberGenerator(uint64_t seed = 0) {
+        setSeed(seed);
+    }
+
+    uint64_t seed() const {
+        return _key[0] | uint64_t(_key[1]) << 32;
+    }
+    void setSeed(uint64_t seed) {
+        _key = {uint32_t(seed), uint32_t(seed >> 32)};
     }
 
-    float operator()() {
-        return dist(rng);
+    Block block(Block counter) const {
+        std::array<uint32_t, 2> key = _key;
+        for (int i = 0; i < 10; i++) {
+            uint64_t product0 = uint64_t(0xD2511F53u) * counter[0];
+            uint64_t product1 = uint64_t(0xCD9E8D57u) * counter[2];
+            counter = {
+                uint32_t(product1 >> 32) ^ counter[1] ^ key[0], uint32_t(product1),
+                uint32_t(product0 >> 32) ^ counter[3] ^ key[1], uint32_t(product0)
+            };
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+        return counter;
+    }
+
+    // Soup cells are alive when their 16-bit lane is below the threshold, out of 65536
+    static uint32_t soupThreshold(float probability) {
+        return uint32_t(std::clamp(probability, 0.f, 1.f) * 65536.f + .5f);
+    }
+    // Bit i set for the live cells among the 8 from x = block * 8 of row y: cell x draws lane x % 8 of the block
+    // counting (x / 8, y, 0, 0), the low half of word (x % 8) / 2 first
+    uint8_t soupBlock(uint32_t block_x, uint32_t y, uint32_t threshold) const {
+        Block words = block({block_x, y, 0, 0});
+        uint8_t cells = 0;
+        for (int lane = 0; lane < 8; lane++) {
+            uint32_t value = words[lane / 2] >> (16 * (lane % 2)) & 0xFFFF;
+            cells |= uint8_t(value < threshold) << lane;
+        }
+        return cells;
     }
 
 private:
-    std::random_device dev;
-    std::mt19937 rng;
-    std::uniform_real_distribution<float> dist;
+    std::array<uint32_t, 2> _key;
 };
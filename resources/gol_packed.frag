@@ -0,0 +1,16 @@
+#version 460
+
+in vec2 v_uv;
+
+out vec4 f_color;
+
+// gol_packed.comp state, 32 cells per texel
+uniform usampler2D u_texture;
+uniform ivec2 u_resolution;
+
+void main() {
+    ivec2 cell = min(ivec2(v_uv * vec2(u_resolution)), u_resolution - 1);
+    uint word = texelFetch(u_texture, ivec2(cell.x / 32, cell.y), 0).r;
+    float value = float((word >> (cell.x % 32)) & 1u);
+    f_color = vec4(vec3(value), 1);
+}
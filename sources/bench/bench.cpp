@@ -0,0 +1,60 @@
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "gol/cpu_engine.hpp"
+#include "gol/kernel.hpp"
+#include "gol/lut_engine.hpp"
+
+// Times the random soup fill, then steps the soup with every temporal blocking depth and with the block lookup table,
+// and prints the throughput of each.
+// Usage: gol-bench [size] [generations] [tile size] [threads]
+int main(int argc, char** argv) {
+    int size = argc > 1 ? std::stoi(argv[1]) : 4096;
+    int generations = argc > 2 ? std::stoi(argv[2]) : 252;
+    int tile_size = argc > 3 ? std::stoi(argv[3]) : 1024;
+    int threads = argc > 4 ? std::stoi(argv[4]) : 0;
+
+    std::cout << std::format(
+                     "{}x{}, {} generations, {} cell tiles, kernel {}", size, size, generations, tile_size,
+                     kernelIsaName(kernelIsa())
+                 )
+              << std::endl;
+
+    // 50% soup, exactly 32768 / 65536
+    CpuEngineOptions soup_options;
+    soup_options.threads = threads;
+    CpuEngine soup_engine(size, size, soup_options);
+    auto start = std::chrono::steady_clock::now();
+    soup_engine.loadSoup(1, 32768);
+    double soup_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::format("soup: {:.1f} ms, population {}", soup_ms, soup_engine.population()) << std::endl;
+    const BitGrid& soup = soup_engine.grid();
+
+    for (int steps : {1, 2, 4, 6, 12, 21, 42, 63}) {
+        CpuEngineOptions options;
+        options.threads = threads;
+        options.tile_size = tile_size;
+        options.skip_stable_tiles = false;
+        options.temporal_steps = steps;
+        CpuEngine engine(size, size, options);
+        engine.grid() = soup;
+        engine.step(generations);
+        std::cout << std::format(
+                         "temporal steps {:2}: {:6.2f} Gcells/s, population {}, {}x{} tiles", steps,
+                         engine.cellsPerSecond() / 1e9, engine.population(), engine.tileWidth(), engine.tileSize()
+                     )
+                  << std::endl;
+    }
+
+    // The block table engine's speed does not depend on the rule
+    LutEngine lut(size, size, threads);
+    lut.grid() = soup;
+    lut.step(generations);
+    std::cout << std::format(
+                     "lookup table:      {:6.2f} Gcells/s, population {}", lut.cellsPerSecond() / 1e9, lut.population()
+                 )
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#include "gol/bit_grid.hpp"
+
+BitGrid::BitGrid(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("BitGrid dimensions must be positive");
+    }
+    _width = width;
+    _height = height;
+    _words = (width + 63) / 64;
+    int last_bits = width - (_words - 1) * 64;
+    _last_mask = last_bits == 64 ? ~uint64_t(0) : (uint64_t(1) << last_bits) - 1;
+    _data.assign(static_cast<size_t>(stride()) * height, 0);
+}
+
+void BitGrid::clear() {
+    std::fill(_data.begin(), _data.end(), 0);
+}
+
+uint64_t BitGrid::population() const {
+    uint64_t count = 0;
+    for (int y = 0; y < _height; y++) {
+        const uint64_t* r = row(y);
+        for (int i = 0; i < _words - 1; i++) {
+            count += std::popcount(r[i]);
+        }
+        count += std::popcount(r[_words - 1] & _last_mask);
+    }
+    return count;
+}
+
+uint64_t BitGrid::fetch(int y, int64_t x) const {
+    const uint64_t* r = row(y);
+    int64_t start = x % _width;
+    if (start < 0) {
+        start += _width;
+    }
+    if (_width < 128) {
+        uint64_t bits = 0;
+        for (int j = 0, cx = start; j < 64; j++, cx = cx + 1 == _width ? 0 : cx + 1) {
+            bits |= (r[cx >> 6] >> (cx & 63) & 1) << j;
+        }
+        return bits;
+    }
+    // A 64 cell window wraps at most once when the row is at least 128 cells wide
+    auto read = [&](int64_t at) {
+        int i = at >> 6;
+        int offset = at & 63;
+        uint64_t lo = i == _words - 1 ? r[i] & _last_mask : r[i];
+        if (offset == 0) {
+            return lo;
+        }
+        uint64_t hi = i + 1 < _words ? (i + 1 == _words - 1 ? r[i + 1] & _last_mask : r[i + 1]) : 0;
+        return lo >> offset | hi << (64 - offset);
+    };
+    uint64_t bits = read(start);
+    int64_t available = _width - start;
+    if (available < 64) {
+        bits = (bits & ((uint64_t(1) << available) - 1)) | read(0) << available;
+    }
+    return bits;
+}
+
+void BitGrid::fillHalo(int y) {
+    uint64_t* r = row(y);
+    if (_last_mask != ~uint64_t(0)) {
+        int last_bits = std::popcount(_last_mask);
+        r[_words - 1] = (r[_words - 1] & _last_mask) | fetch(y, 0) << last_bits;
+    }
+    r[-1] = fetch(y, -64);
+    r[_words] = fetch(y, static_cast<int64_t>(_words) * 64);
+}
+
+void BitGrid::fillHalo() {
+    for (int y = 0; y < _height; y++) {
+        fillHalo(y);
+    }
+}
+
+void BitGrid::maskPadding() {
+    for (int y = 0; y < _height; y++) {
+        row(y)[_words - 1] &= _last_mask;
+    }
+}
+
+void BitGrid::paste(const BitGrid& source, int x, int y) {
+    int64_t x_begin = std::max(0, x);
+    int64_t x_end = std::min<int64_t>(_width, int64_t(x) + source.width());
+    if (x_begin >= x_end) {
+        return;
+    }
+    for (int ty = std::max(0, y); ty < std::min<int64_t>(_height, int64_t(y) + source.height()); ty++) {
+        uint64_t* r = row(ty);
+        for (int64_t word = x_begin / 64; word <= (x_end - 1) / 64; word++) {
+            // The cells of this word that come from `source`, the rest of the fetched window wrapped around it
+            int64_t first = std::max(word * 64, x_begin) - word * 64;
+            int64_t count = std::min(word * 64 + 64, x_end) - word * 64 - first;
+            uint64_t mask = (count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1) << first;
+            uint64_t bits = source.fetch(ty - y, word * 64 - x);
+            r[word] = (r[word] & ~mask) | (bits & mask);
+        }
+    }
+}
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include "gol/cpu_engine.hpp"
+#include "gol/kernel.hpp"
+
+CpuEngine::CpuEngine(int width, int height, const CpuEngineOptions& options)
+    : _current(width, height),
+      _next(width, height),
+      _pool(std::make_unique<ThreadPool>(options.threads)),
+      _skip_stable_tiles(options.skip_stable_tiles) {
+    if (options.tile_size <= 0) {
+        throw std::invalid_argument("Tile size must be positive");
+    }
+    // The halo of a temporal block is a single word on each side
+    if (options.temporal_steps < 1 || options.temporal_steps > 63) {
+        throw std::invalid_argument("Temporal steps must be between 1 and 63");
+    }
+    _temporal_steps = options.temporal_steps;
+    _tile_rows = std::min(options.tile_size, height);
+    // Tiles are whole words wide, the kernels take care of any tail shorter than their registers
+    _tile_words = std::min((options.tile_size + 63) / 64, _current.words());
+    _tiles_x = (_current.words() + _tile_words - 1) / _tile_words;
+    _tiles_y = (height + _tile_rows - 1) / _tile_rows;
+    _band_pending = std::make_unique<std::atomic<int>[]>(_tiles_y);
+    _changed.assign(tileCount(), 1);
+    _next_changed.assign(tileCount(), 0);
+
+    const int conway[RULE_COUNT] = {0, 0, 2, 1, 0, 0, 0, 0, 0};
+    setRules(conway);
+}
+
+void CpuEngine::setRules(const int rules[RULE_COUNT]) {
+    _rules = compileRules(rules);
+    _edited = true;
+}
+
+void CpuEngine::step(int generations) {
+    auto start = std::chrono::steady_clock::now();
+    // Cells may have been edited since the last step, later passes get their guard words from stepTile()
+    _current.fillHalo();
+    if (_edited) {
+        std::fill(_changed.begin(), _changed.end(), 1);
+        _edited = false;
+    }
+    _skipped_tiles = 0;
+    int passes = 0;
+    for (int g = 0; g < generations;) {
+        int steps = std::min(_temporal_steps, generations - g);
+        if (steps != _last_pass_steps) {
+            std::fill(_changed.begin(), _changed.end(), 1);
+            _last_pass_steps = steps;
+        }
+        for (int band = 0; band < _tiles_y; band++) {
+            _band_pending[band] = _tiles_x;
+        }
+        _pool->parallelFor(tileCount(), [this, steps](int tile) { stepTile(tile, steps); });
+        std::swap(_current, _next);
+        std::swap(_changed, _next_changed);
+        _generation += steps;
+        g += steps;
+        passes++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (generations > 0 && seconds > 0) {
+        _cells_per_second = static_cast<double>(width()) * height() * generations / seconds;
+    }
+    if (passes > 0) {
+        _skipped_fraction = static_cast<double>(_skipped_tiles) / (static_cast<double>(tileCount()) * passes);
+    }
+}
+
+bool CpuEngine::canSkip(int steps) const {
+    if (!_skip_stable_tiles) {
+        return false;
+    }
+    // A pass only reads cells `steps` away from a tile, which must stay within its 3x3 neighborhood.
+    // Tiles on the last row or column can be narrower than the others.
+    int last_rows = height() - (_tiles_y - 1) * _tile_rows;
+    int last_cells = width() - (_tiles_x - 1) * _tile_words * 64;
+    bool rows_fit = _tiles_y <= 3 || steps <= std::min(_tile_rows, last_rows);
+    bool cells_fit = _tiles_x <= 3 || steps <= std::min(_tile_words * 64, last_cells);
+    return rows_fit && cells_fit;
+}
+
+bool CpuEngine::neighborhoodChanged(int tile) const {
+    int tile_x = tile % _tiles_x;
+    int tile_y = tile / _tiles_x;
+    for (int dy = -1; dy <= 1; dy++) {
+        int y = (tile_y + dy + _tiles_y) % _tiles_y;
+        for (int dx = -1; dx <= 1; dx++) {
+            int x = (tile_x + dx + _tiles_x) % _tiles_x;
+            if (_changed[y * _tiles_x + x]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CpuEngine::stepTile(int tile, int steps) {
+    int band = tile / _tiles_x;
+    int word_begin = tile % _tiles_x * _tile_words;
+    int words = std::min(_tile_words, _current.words() - word_begin);
+    int row_begin = band * _tile_rows;
+    int row_end = std::min(row_begin + _tile_rows, height());
+
+    if (canSkip(steps) && !neighborhoodChanged(tile)) {
+        _next_changed[tile] = 0;
+        _skipped_tiles.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        uint64_t difference = steps == 1 ? stepRows(row_begin, row_end, word_begin, words)
+                                         : stepBlock(row_begin, row_end, word_begin, words, steps);
+        _next_changed[tile] = difference != 0;
+    }
+
+    if (_band_pending[band].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        for (int y = row_begin; y < row_end; y++) {
+            _next.fillHalo(y);
+        }
+    }
+}
+
+uint64_t CpuEngine::stepRows(int row_begin, int row_end, int word_begin, int words) {
+    int height = this->height();
+    bool last_column = word_begin + words == _current.words();
+    uint64_t difference = 0;
+    for (int y = row_begin; y < row_end; y++) {
+        const uint64_t* above = _current.row(y == 0 ? height - 1 : y - 1) + word_begin;
+        const uint64_t* below = _current.row(y == height - 1 ? 0 : y + 1) + word_begin;
+        const uint64_t* row = _current.row(y) + word_begin;
+        uint64_t* out = _next.row(y) + word_begin;
+        stepRow(above, row, below, out, words, _rules);
+        // The unused bits of the last word hold guard cells in the input and leftovers in the output
+        if (last_column) {
+            out[words - 1] &= _current.lastWordMask();
+        }
+        for (int i = 0; i < words; i++) {
+            difference |= out[i] ^ (last_column && i == words - 1 ? row[i] & _current.lastWordMask() : row[i]);
+        }
+    }
+    return difference;
+}
+
+uint64_t CpuEngine::stepBlock(int row_begin, int row_end, int word_begin, int words, int steps) {
+    // Local rows are the tile's words with the grid word on each side as halo, and a zero guard word past
+    // those for stepRow. Cells past the halo are unknown, and the error creeps in by one cell per generation,
+    // so after at most 63 generations it has not left the halo words yet.
+    int height = this->height();
+    int stride = words + 4;
+    int rows = row_end - row_begin + 2 * steps;
+    thread_local std::vector<uint64_t> buffers[2];
+    for (auto& buffer : buffers) {
+        if (buffer.size() < static_cast<size_t>(stride) * rows) {
+            buffer.resize(static_cast<size_t>(stride) * rows);
+        }
+    }
+    auto local = [&](int buffer, int r) {
+        return buffers[buffer].data() + static_cast<size_t>(r) * stride + 1;
+    };
+
+    // The halo words of the grid are filled, so a tile on the edge copies its wrapped neighbors as well
+    for (int r = 0; r < rows; r++) {
+        int y = ((row_begin - steps + r) % height + height) % height;
+        uint64_t* out = local(0, r);
+        out[-1] = 0;
+        std::copy_n(_current.row(y) + word_begin - 1, words + 2, out);
+        out[words + 2] = 0;
+    }
+    // Every generation leaves one more row at each end out of date
+    for (int g = 1; g <= steps; g++) {
+        int in = (g - 1) & 1;
+        int out = g & 1;
+        for (int r = g; r < rows - g; r++) {
+            local(out, r)[-1] = 0;
+            local(out, r)[words + 2] = 0;
+            stepRow(local(in, r - 1), local(in, r), local(in, r + 1), local(out, r), words + 2, _rules);
+        }
+    }
+
+    bool last_column = word_begin + words == _current.words();
+    uint64_t difference = 0;
+    for (int y = row_begin; y < row_end; y++) {
+        const uint64_t* result = local(steps & 1, y - row_begin + steps) + 1;
+        const uint64_t* row = _current.row(y) + word_begin;
+        uint64_t* out = _next.row(y) + word_begin;
+        std::copy_n(result, words, out);
+        if (last_column) {
+            out[words - 1] &= _current.lastWordMask();
+        }
+        for (int i = 0; i < words; i++) {
+            difference |= out[i] ^ (last_column && i == words - 1 ? row[i] & _current.lastWordMask() : row[i]);
+        }
+    }
+    return difference;
+}
+
+void CpuEngine::clear() {
+    _current.clear();
+    _generation = 0;
+    _edited = true;
+}
+
+void CpuEngine::loadCells(const std::vector<float>& cells) {
+    if (cells.size() != static_cast<size_t>(width()) * height()) {
+        throw std::invalid_argument("Cell buffer does not match the universe size");
+    }
+    _current.clear();
+    _edited = true;
+    for (int y = 0; y < height(); y++) {
+        for (int x = 0; x < width(); x++) {
+            if (cells[static_cast<size_t>(y) * width() + x] > 0.5f) {
+                _current.set(x, y, true);
+            }
+        }
+    }
+}
+
+void CpuEngine::loadSoup(uint64_t seed, uint32_t threshold) {
+    _edited = true;
+    _pool->parallelFor(height(), [&](int y) {
+        uint64_t* row = _current.row(y);
+        soupRow(seed, threshold, y, row, _current.words());
+        row[_current.words() - 1] &= _current.lastWordMask();
+    });
+}
+
+std::vector<float> CpuEngine::storeCells() const {
+    std::vector<float> cells(static_cast<size_t>(width()) * height());
+    for (int y = 0; y < height(); y++) {
+        for (int x = 0; x < width(); x++) {
+            cells[static_cast<size_t>(y) * width() + x] = _current.get(x, y) ? 1.0f : 0.0f;
+        }
+    }
+    return cells;
+}
@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "gol/hashlife.hpp"
+
+HashLife::HashLife(const int rules[RULE_COUNT], size_t memory_budget) {
+    // Ids 0 and 1 are the two level 0 cells, never hashed nor collected
+    _nodes.resize(2);
+    rehash(1 << 16);
+    _empty.push_back(DEAD);
+    for (int level = 1; level <= MAX_LEVEL; level++) {
+        NodeId e = _empty.back();
+        _empty.push_back(join(e, e, e, e));
+    }
+    _root = _empty[3];
+    setRules(rules);
+    setMemoryBudget(memory_budget);
+}
+
+void HashLife::setRules(const int rules[RULE_COUNT]) {
+    if (rules[0] == RULE_BIRTH) {
+        throw std::invalid_argument("HashLife cannot run rules giving birth with no neighbors");
+    }
+    _rules = compileRules(rules);
+    clearResults();
+}
+
+void HashLife::setMemoryBudget(size_t bytes) {
+    _memory_budget = std::max(bytes, MIN_MEMORY_BUDGET);
+    _collect_threshold = _memory_budget / (sizeof(Node) + sizeof(NodeId));
+}
+
+size_t HashLife::memoryUsage() const {
+    return _nodes.size() * sizeof(Node) + _buckets.size() * sizeof(NodeId);
+}
+
+size_t HashLife::bucketOf(NodeId nw, NodeId ne, NodeId sw, NodeId se) const {
+    uint64_t h = nw;
+    h = h * 0x9E3779B97F4A7C15ull + ne;
+    h = h * 0x9E3779B97F4A7C15ull + sw;
+    h = h * 0x9E3779B97F4A7C15ull + se;
+    h ^= h >> 29;
+    return h & (_buckets.size() - 1);
+}
+
+void HashLife::rehash(size_t buckets) {
+    _buckets.assign(buckets, NONE);
+    for (NodeId id = 2; id < _nodes.size(); id++) {
+        Node& n = _nodes[id];
+        if (n.level == FREE) {
+            continue;
+        }
+        size_t bucket = bucketOf(n.nw, n.ne, n.sw, n.se);
+        n.next = _buckets[bucket];
+        _buckets[bucket] = id;
+    }
+}
+
+HashLife::NodeId HashLife::allocate() {
+    NodeId id;
+    if (_free != NONE) {
+        id = _free;
+        _free = _nodes[id].next;
+    } else {
+        if (_nodes.size() >= NONE) {
+            throw std::length_error("HashLife node store is full");
+        }
+        id = static_cast<NodeId>(_nodes.size());
+        _nodes.emplace_back();
+    }
+    _live_nodes++;
+    return id;
+}
+
+HashLife::NodeId HashLife::join(NodeId nw, NodeId ne, NodeId sw, NodeId se) {
+    size_t bucket = bucketOf(nw, ne, sw, se);
+    for (NodeId id = _buckets[bucket]; id != NONE; id = _nodes[id].next) {
+        const Node& n = _nodes[id];
+        if (n.nw == nw && n.ne == ne && n.sw == sw && n.se == se) {
+            return id;
+        }
+    }
+    // Only the node storage grows here, collections happen at the start of result()
+    if (_live_nodes + 1 > _buckets.size()) {
+        rehash(_buckets.size() * 2);
+    }
+    NodeId id = allocate();
+    bucket = bucketOf(nw, ne, sw, se);
+    Node& n = _nodes[id];
+    n.nw = nw;
+    n.ne = ne;
+    n.sw = sw;
+    n.se = se;
+    n.result = NONE;
+    n.level = _nodes[nw].level + 1;
+    n.marked = false;
+    n.next = _buckets[bucket];
+    _buckets[bucket] = id;
+    return id;
+}
+
+HashLife::NodeId HashLife::centered(NodeId node) {
+    Node n = _nodes[node];
+    return join(_nodes[n.nw].se, _nodes[n.ne].sw, _nodes[n.sw].ne, _nodes[n.se].nw);
+}
+
+HashLife::NodeId HashLife::expand(NodeId node) {
+    Node n = _nodes[node];
+    if (n.level >= MAX_LEVEL) {
+        throw std::overflow_error("Pattern outgrew the HashLife coordinate range");
+    }
+    NodeId e = _empty[n.level - 1];
+    return join(join(e, e, e, n.nw), join(e, e, n.ne, e), join(e, n.sw, e, e), join(n.se, e, e, e));
+}
+
+bool HashLife::borderIsEmpty(NodeId node) const {
+    Node n = _nodes[node];
+    NodeId e = _empty[n.level - 2];
+    const Node &nw = _nodes[n.nw], &ne = _nodes[n.ne], &sw = _nodes[n.sw], &se = _nodes[n.se];
+    return nw.nw == e && nw.ne == e && nw.sw == e && ne.nw == e && ne.ne == e && ne.se == e && sw.nw == e &&
+           sw.sw == e && sw.se == e && se.ne == e && se.sw == e && se.se == e;
+}
+
+HashLife::NodeId HashLife::baseResult(NodeId node) {
+    bool cells[4][4];
+    Node n = _nodes[node];
+    NodeId quadrants[4] = {n.nw, n.ne, n.sw, n.se};
+    for (int q = 0; q < 4; q++) {
+        for (int s = 0; s < 4; s++) {
+            cells[(q >> 1) * 2 + (s >> 1)][(q & 1) * 2 + (s & 1)] = child(quadrants[q], s) == ALIVE;
+        }
+    }
+    NodeId next[4];
+    for (int i = 0; i < 4; i++) {
+        int x = 1 + (i & 1);
+        int y = 1 + (i >> 1);
+        int neighbors = 0;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                neighbors += (dx || dy) && cells[y + dy][x + dx];
+            }
+        }
+        next[i] = applyRule(_rules, neighbors, cells[y][x]) ? ALIVE : DEAD;
+    }
+    return join(next[0], next[1], next[2], next[3]);
+}
+
+HashLife::NodeId HashLife::result(NodeId node) {
+    if (_nodes[node].result != NONE) {
+        return _nodes[node].result;
+    }
+    size_t stack_base = _stack.size();
+    _stack.push_back(node);
+    maybeCollect();
+
+    // Everything built below is pushed on _stack until the result is stored, as a collection can happen in
+    // any of the nested result() calls
+    auto keep = [&](NodeId id) {
+        _stack.push_back(id);
+        return id;
+    };
+
+    NodeId next;
+    int level = _nodes[node].level;
+    if (level == 2) {
+        next = baseResult(node);
+    } else {
+        Node n = _nodes[node];
+        Node a = _nodes[n.nw], b = _nodes[n.ne], c = _nodes[n.sw], d = _nodes[n.se];
+        NodeId parts[9] = {
+            n.nw,
+            keep(join(a.ne, b.nw, a.se, b.sw)),
+            n.ne,
+            keep(join(a.sw, a.se, c.nw, c.ne)),
+            keep(join(a.se, b.sw, c.ne, d.nw)),
+            keep(join(b.sw, b.se, d.nw, d.ne)),
+            n.sw,
+            keep(join(c.ne, d.nw, c.se, d.sw)),
+            n.se,
+        };
+        NodeId r[9];
+        for (int i = 0; i < 9; i++) {
+            r[i] = keep(result(parts[i]));
+        }
+        NodeId quarters[4] = {
+            keep(join(r[0], r[1], r[3], r[4])),
+            keep(join(r[1], r[2], r[4], r[5])),
+            keep(join(r[3], r[4], r[6], r[7])),
+            keep(join(r[4], r[5], r[7], r[8])),
+        };
+        // A full speed node runs its quarters for the second half of the jump, a slower one only recenters them
+        bool full_speed = _result_step >= level - 2;
+        NodeId q[4];
+        for (int i = 0; i < 4; i++) {
+            q[i] = keep(full_speed ? result(quarters[i]) : centered(quarters[i]));
+        }
+        next = join(q[0], q[1], q[2], q[3]);
+    }
+
+    _nodes[node].result = next;
+    _stack.resize(stack_base);
+    return next;
+}
+
+void HashLife::stepPow2(int k) {
+    if (k < 0 || k > MAX_LEVEL - 3) {
+        throw std::invalid_argument("Step exponent out of range");
+    }
+    if (k != _result_step) {
+        clearResults();
+        _result_step = k;
+    }
+    // The result of a level L node is its center half after 2^(L-2) generations: keeping the pattern in the
+    // center quarter of a node of level k + 3 or more leaves room for it to grow at up to one cell per generation
+    while (level(_root) < k + 3 || !borderIsEmpty(_root)) {
+        _root = expand(_root);
+    }
+    _root = expand(_root);
+    _stack.clear();
+    _root = result(_root);
+    _generation += uint64_t(1) << k;
+}
+
+void HashLife::step(uint64_t generations) {
+    for (int k = 0; generations; k++, generations >>= 1) {
+        if (generations & 1) {
+            stepPow2(k);
+        }
+    }
+}
+
+void HashLife::clearResults() {
+    for (Node& n : _nodes) {
+        n.result = NONE;
+    }
+}
+
+void HashLife::maybeCollect() {
+    if (_live_nodes >= _collect_threshold) {
+        collect();
+    }
+}
+
+void HashLife::mark(NodeId node) {
+    Node& n = _nodes[node];
+    if (n.marked || n.level == 0) {
+        return;
+    }
+    n.marked = true;
+    mark(n.nw);
+    mark(n.ne);
+    mark(n.sw);
+    mark(n.se);
+}
+
+void HashLife::collect() {
+    size_t max_nodes = _memory_budget / (sizeof(Node) + sizeof(NodeId));
+    size_t live_before = _live_nodes;
+    sweep();
+    // Keeping all the results was not enough, try again with only the pattern and the recursion
+    if (_live_nodes > max_nodes / 2) {
+        bool dropped = false;
+        for (Node& n : _nodes) {
+            if (n.level != FREE && n.result != NONE) {
+                n.result = NONE;
+                dropped = true;
+            }
+        }
+        if (dropped) {
+            sweep();
+        }
+    }
+    size_t buckets = _buckets.size();
+    while (buckets > (1 << 16) && buckets / 4 > _live_nodes) {
+        buckets /= 2;
+    }
+    rehash(buckets);
+    _collections++;
+
+    // When what is left is needed the store grows past the budget, doubling for as long as collections free less
+    // than half of it, so a working set bigger than the budget costs a collection per doubling rather than one
+    // every few nodes
+    if (_live_nodes > live_before / 2) {
+        _collect_threshold = std::max(max_nodes, live_before * 2);
+    } else {
+        _collect_threshold = std::max(max_nodes, _live_nodes * 2);
+    }
+}
+
+void HashLife::sweep() {
+    for (Node& n : _nodes) {
+        n.marked = false;
+    }
+    for (NodeId e : _empty) {
+        mark(e);
+    }
+    mark(_root);
+    for (NodeId id : _stack) {
+        mark(id);
+    }
+    // Memoized results are only worth keeping while their owner is alive
+    for (NodeId id = 2; id < _nodes.size(); id++) {
+        const Node& n = _nodes[id];
+        if (n.marked && n.level != FREE && n.result != NONE) {
+            mark(n.result);
+        }
+    }
+    // Results are marked in one pass only, their own results are dropped below when they did not make it
+    for (NodeId id = 2; id < _nodes.size(); id++) {
+        Node& n = _nodes[id];
+        if (n.level == FREE) {
+            continue;
+        }
+        if (!n.marked) {
+            n.level = FREE;
+            n.next = _free;
+            _free = id;
+            _live_nodes--;
+        }
+    }
+    for (NodeId id = 2; id < _nodes.size(); id++) {
+        Node& n = _nodes[id];
+        if (n.level != FREE && n.result != NONE && _nodes[n.result].level == FREE) {
+            n.result = NONE;
+        }
+    }
+}
+
+void HashLife::setRoot(NodeId node) {
+    while (level(node) < 3) {
+        node = expand(node);
+    }
+    _root = node;
+}
+
+bool HashLife::getCell(int64_t x, int64_t y) const {
+    NodeId node = _root;
+    int level = this->level(node);
+    int64_t half = int64_t(1) << (level - 1);
+    if (x < -half || x >= half || y < -half || y >= half) {
+        return false;
+    }
+    x += half;
+    y += half;
+    while (level > 0) {
+        level--;
+        int64_t size = int64_t(1) << level;
+        int quadrant = (x >= size) + 2 * (y >= size);
+        node = child(node, quadrant);
+        x &= size - 1;
+        y &= size - 1;
+    }
+    return node == ALIVE;
+}
+
+HashLife::NodeId HashLife::setCell(NodeId node, int level, int64_t x, int64_t y, bool alive) {
+    if (level == 0) {
+        return alive ? ALIVE : DEAD;
+    }
+    int64_t size = int64_t(1) << (level - 1);
+    int quadrant = (x >= size) + 2 * (y >= size);
+    NodeId children[4] = {child(node, 0), child(node, 1), child(node, 2), child(node, 3)};
+    children[quadrant] = setCell(children[quadrant], level - 1, x & (size - 1), y & (size - 1), alive);
+    return join(children[0], children[1], children[2], children[3]);
+}
+
+void HashLife::setCell(int64_t x, int64_t y, bool alive) {
+    while (true) {
+        int64_t half = int64_t(1) << (level(_root) - 1);
+        if (x >= -half && x < half && y >= -half && y < half) {
+            _root = setCell(_root, level(_root), x + half, y + half, alive);
+            return;
+        }
+        _root = expand(_root);
+    }
+}
+
+void HashLife::clear() {
+    _root = _empty[3];
+    _generation = 0;
+}
+
+uint64_t HashLife::population() const {
+    std::unordered_map<NodeId, uint64_t> counts;
+    auto count = [&](auto& self, NodeId node) -> uint64_t {
+        if (node <= ALIVE) {
+            return node;
+        }
+        if (node == _empty[_nodes[node].level]) {
+            return 0;
+        }
+        if (auto it = counts.find(node); it != counts.end()) {
+            return it->second;
+        }
+        const Node& n = _nodes[node];
+        uint64_t total = self(self, n.nw) + self(self, n.ne) + self(self, n.sw) + self(self, n.se);
+        counts.emplace(node, total);
+        return total;
+    };
+    return count(count, _root);
+}
+
+bool HashLife::bounds(int64_t& left, int64_t& top, int64_t& right, int64_t& bottom) const {
+    // Live cell extents of each distinct node, from its top left corner, an empty node's being inverted
+    using Extents = std::array<int64_t, 4>;
+    constexpr Extents NO_CELLS = {INT64_MAX, INT64_MAX, INT64_MIN, INT64_MIN};
+    std::unordered_map<NodeId, Extents> extents;
+    auto find = [&](auto& self, NodeId node) -> Extents {
+        if (node == ALIVE) {
+            return {0, 0, 1, 1};
+        }
+        int level = _nodes[node].level;
+        if (node == _empty[level]) {
+            return NO_CELLS;
+        }
+        if (auto it = extents.find(node); it != extents.end()) {
+            return it->second;
+        }
+        int64_t half = int64_t(1) << (level - 1);
+        Extents total = NO_CELLS;
+        for (int quadrant = 0; quadrant < 4; quadrant++) {
+            Extents part = self(self, child(node, quadrant));
+            if (part[0] > part[2]) {
+                continue;
+            }
+            int64_t x = (quadrant & 1) * half;
+            int64_t y = (quadrant >> 1) * half;
+            total = {
+                std::min(total[0], part[0] + x), std::min(total[1], part[1] + y), std::max(total[2], part[2] + x),
+                std::max(total[3], part[3] + y)
+            };
+        }
+        extents.emplace(node, total);
+        return total;
+    };
+    Extents root = find(find, _root);
+    if (root[0] > root[2]) {
+        return false;
+    }
+    int64_t half = int64_t(1) << (level(_root) - 1);
+    left = root[0] - half;
+    top = root[1] - half;
+    right = root[2] - half;
+    bottom = root[3] - half;
+    return true;
+}
+
+HashLife::NodeId HashLife::build(
+    const BitGrid& grid, int level, int64_t x, int64_t y, int64_t offset_x, int64_t offset_y
+) {
+    int64_t size = int64_t(1) << level;
+    if (x + size <= offset_x || y + size <= offset_y || x >= offset_x + grid.width() ||
+        y >= offset_y + grid.height()) {
+        return _empty[level];
+    }
+    if (level == 0) {
+        return grid.get(static_cast<int>(x - offset_x), static_cast<int>(y - offset_y)) ? ALIVE : DEAD;
+    }
+    int64_t half = size / 2;
+    return join(
+        build(grid, level - 1, x, y, offset_x, offset_y), build(grid, level - 1, x + half, y, offset_x, offset_y),
+        build(grid, level - 1, x, y + half, offset_x, offset_y),
+        build(grid, level - 1, x + half, y + half, offset_x, offset_y)
+    );
+}
+
+void HashLife::loadGrid(const BitGrid& grid, int64_t x, int64_t y) {
+    int64_t extent = std::max({std::abs(x), std::abs(y), std::abs(x + grid.width()), std::abs(y + grid.height())});
+    int level = 3;
+    while ((int64_t(1) << (level - 1)) < extent) {
+        level++;
+    }
+    if (level > MAX_LEVEL) {
+        throw std::overflow_error("Grid does not fit the HashLife coordinate range");
+    }
+    int64_t half = int64_t(1) << (level - 1);
+    _root = build(grid, level, -half, -half, x, y);
+}
+
+void HashLife::store(
+    NodeId node, int level, int64_t x, int64_t y, BitGrid& grid, int64_t offset_x, int64_t offset_y
+) const {
+    int64_t size = int64_t(1) << level;
+    if (node == _empty[level] || x + size <= offset_x || y + size <= offset_y || x >= offset_x + grid.width() ||
+        y >= offset_y + grid.height()) {
+        return;
+    }
+    if (level == 0) {
+        grid.set(static_cast<int>(x - offset_x), static_cast<int>(y - offset_y), true);
+        return;
+    }
+    int64_t half = size / 2;
+    const Node& n = _nodes[node];
+    store(n.nw, level - 1, x, y, grid, offset_x, offset_y);
+    store(n.ne, level - 1, x + half, y, grid, offset_x, offset_y);
+    store(n.sw, level - 1, x, y + half, grid, offset_x, offset_y);
+    store(n.se, level - 1, x + half, y + half, grid, offset_x, offset_y);
+}
+
+void HashLife::storeGrid(BitGrid& grid, int64_t x, int64_t y) const {
+    grid.clear();
+    int level = this->level(_root);
+    int64_t half = int64_t(1) << (level - 1);
+    store(_root, level, -half, -half, grid, x, y);
+}
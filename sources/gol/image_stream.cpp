@@ -0,0 +1,471 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <csetjmp>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef GOL_HAVE_PNG
+#include <png.h>
+#endif
+
+#include "gol/image_stream.hpp"
+#include "gol/kernel.hpp"
+
+// Decoders fill rows of one byte per pixel, the gray level or the red channel, one row per call, in file order
+struct ImageStream::Decoder {
+    virtual ~Decoder() = default;
+    virtual void readRow(uint8_t* pixels) = 0;
+
+    int width = 0;
+    int height = 0;
+    bool bottom_up = false;
+};
+
+namespace {
+
+void checkSize(const std::string& path, int64_t width, int64_t height) {
+    // Rows are indexed with ints and textures are at most this wide anyway
+    if (width <= 0 || height <= 0 || width > (1 << 30) || height > (1 << 30)) {
+        throw std::runtime_error(path + ": unsupported image size");
+    }
+}
+
+class FileDecoder : public ImageStream::Decoder {
+public:
+    explicit FileDecoder(const std::string& path) : _path(path), _in(path, std::ios::binary) {
+        if (!_in) {
+            throw std::runtime_error(path + " not found");
+        }
+    }
+
+protected:
+    void readBytes(void* data, size_t size) {
+        _in.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+        if (!_in) {
+            throw std::runtime_error(_path + ": truncated image");
+        }
+    }
+
+    std::string _path;
+    std::ifstream _in;
+    std::vector<uint8_t> _row;
+};
+
+// Binary PBM, PGM and PPM. 16-bit samples keep their high byte, as stb_image does.
+class PnmDecoder : public FileDecoder {
+public:
+    explicit PnmDecoder(const std::string& path) : FileDecoder(path) {
+        char magic[2];
+        readBytes(magic, 2);
+        if (magic[0] != 'P' || (magic[1] != '4' && magic[1] != '5' && magic[1] != '6')) {
+            throw std::runtime_error(path + ": only binary PBM, PGM and PPM files are supported");
+        }
+        _kind = magic[1];
+        int64_t w = header();
+        int64_t h = header();
+        checkSize(path, w, h);
+        width = static_cast<int>(w);
+        height = static_cast<int>(h);
+        int64_t max = _kind == '4' ? 1 : header();
+        if (max <= 0 || max > 65535) {
+            throw std::runtime_error(path + ": unsupported maximum value");
+        }
+        // A single whitespace character separates the header from the samples
+        _in.get();
+        _sample_bytes = max > 255 ? 2 : 1;
+        size_t samples = _kind == '6' ? size_t(width) * 3 : size_t(width);
+        _row.resize(_kind == '4' ? (size_t(width) + 7) / 8 : samples * _sample_bytes);
+    }
+
+    void readRow(uint8_t* pixels) override {
+        readBytes(_row.data(), _row.size());
+        if (_kind == '4') {
+            // Set bits are black
+            for (int x = 0; x < width; x++) {
+                pixels[x] = _row[x / 8] >> (7 - x % 8) & 1 ? 0 : 255;
+            }
+            return;
+        }
+        // The most significant byte of 16-bit samples
+        size_t step = (_kind == '6' ? 3 : 1) * _sample_bytes;
+        for (int x = 0; x < width; x++) {
+            pixels[x] = _row[x * step];
+        }
+    }
+
+private:
+    // Next decimal header field, past whitespace and comments
+    int64_t header() {
+        int c = _in.get();
+        while (c != EOF && (std::isspace(c) || c == '#')) {
+            if (c == '#') {
+                while (c != EOF && c != '\n') {
+                    c = _in.get();
+                }
+            }
+            c = _in.get();
+        }
+        if (c == EOF || !std::isdigit(c)) {
+            throw std::runtime_error(_path + ": malformed header");
+        }
+        int64_t value = 0;
+        while (c != EOF && std::isdigit(c) && value < (int64_t(1) << 40)) {
+            value = value * 10 + (c - '0');
+            c = _in.get();
+        }
+        _in.unget();
+        return value;
+    }
+
+    char _kind = 0;
+    int _sample_bytes = 1;
+};
+
+// Uncompressed BMP: 1, 4 and 8-bit paletted, 24-bit, and 32-bit with or without bit fields
+class BmpDecoder : public FileDecoder {
+public:
+    explicit BmpDecoder(const std::string& path) : FileDecoder(path) {
+        uint8_t file[14];
+        readBytes(file, sizeof(file));
+        if (file[0] != 'B' || file[1] != 'M') {
+            throw std::runtime_error(path + ": not a BMP file");
+        }
+        uint32_t data_offset = read32(file + 10);
+        uint8_t info[124] = {};
+        readBytes(info, 4);
+        uint32_t info_size = read32(info);
+        if (info_size < 40 || info_size > sizeof(info)) {
+            throw std::runtime_error(path + ": unsupported BMP header");
+        }
+        readBytes(info + 4, info_size - 4);
+        int64_t w = static_cast<int32_t>(read32(info + 4));
+        int64_t h = static_cast<int32_t>(read32(info + 8));
+        _bits = read16(info + 14);
+        uint32_t compression = read32(info + 16);
+        uint32_t colors = read32(info + 32);
+        bottom_up = h > 0;
+        checkSize(path, w, h < 0 ? -h : h);
+        width = static_cast<int>(w);
+        height = static_cast<int>(h < 0 ? -h : h);
+
+        constexpr uint32_t RGB = 0;
+        constexpr uint32_t BITFIELDS = 3;
+        if (compression == BITFIELDS && _bits == 32) {
+            uint8_t masks[12];
+            if (info_size >= 52) {
+                std::copy_n(info + 40, 12, masks);
+            } else {
+                readBytes(masks, sizeof(masks));
+            }
+            for (int c = 0; c < 3; c++) {
+                _masks[c] = read32(masks + 4 * c);
+                if (_masks[c] == 0) {
+                    throw std::runtime_error(path + ": unsupported BMP bit fields");
+                }
+            }
+        } else if (compression != RGB || (_bits != 1 && _bits != 4 && _bits != 8 && _bits != 24 && _bits != 32)) {
+            throw std::runtime_error(path + ": only uncompressed 1, 4, 8, 24 and 32-bit BMP files are supported");
+        }
+        if (_bits <= 8) {
+            size_t count = colors ? colors : size_t(1) << _bits;
+            if (count > 256) {
+                throw std::runtime_error(path + ": malformed palette");
+            }
+            std::vector<uint8_t> palette(count * 4);
+            readBytes(palette.data(), palette.size());
+            _palette.fill(0);
+            for (size_t i = 0; i < count; i++) {
+                _palette[i] = palette[4 * i + 2];
+            }
+        }
+        _in.seekg(data_offset);
+        // Rows are padded to 4 bytes
+        _row.resize((size_t(width) * _bits + 31) / 32 * 4);
+    }
+
+    void readRow(uint8_t* pixels) override {
+        readBytes(_row.data(), _row.size());
+        const uint8_t* row = _row.data();
+        switch (_bits) {
+        case 1:
+        case 4:
+        case 8:
+            for (int x = 0; x < width; x++) {
+                size_t bit = size_t(x) * _bits;
+                int index = row[bit / 8] >> (8 - _bits - bit % 8) & ((1 << _bits) - 1);
+                pixels[x] = _palette[index];
+            }
+            break;
+        case 24:
+            for (int x = 0; x < width; x++) {
+                pixels[x] = row[3 * x + 2];
+            }
+            break;
+        default:
+            for (int x = 0; x < width; x++) {
+                pixels[x] = _masks[0] ? channel(read32(row + 4 * x), 0) : row[4 * x + 2];
+            }
+        }
+    }
+
+private:
+    static uint32_t read16(const uint8_t* p) {
+        return p[0] | uint32_t(p[1]) << 8;
+    }
+    static uint32_t read32(const uint8_t* p) {
+        return p[0] | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+    // Masked channel scaled to 8 bits, from its top bits
+    uint32_t channel(uint32_t pixel, int c) const {
+        uint32_t mask = _masks[c];
+        uint32_t value = (pixel & mask) >> std::countr_zero(mask);
+        int bits = std::popcount(mask >> std::countr_zero(mask));
+        return bits >= 8 ? value >> (bits - 8) : value * 255 / ((1u << bits) - 1);
+    }
+
+    int _bits = 0;
+    uint32_t _masks[3] = {};
+    std::array<uint8_t, 256> _palette = {};
+};
+
+#ifdef GOL_HAVE_PNG
+// Non-interlaced PNG through libpng's row API, everything expanded to 8-bit gray or RGB
+class PngDecoder : public ImageStream::Decoder {
+public:
+    explicit PngDecoder(const std::string& path) : _path(path) {
+        _file = std::fopen(path.c_str(), "rb");
+        if (!_file) {
+            throw std::runtime_error(path + " not found");
+        }
+        _png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        _info = _png ? png_create_info_struct(_png) : nullptr;
+        if (!_info) {
+            close();
+            throw std::runtime_error("Could not create a PNG decoder");
+        }
+        // libpng reports errors by jumping back here, then they are thrown as usual outside of its frames
+        if (setjmp(png_jmpbuf(_png))) {
+            close();
+            throw std::runtime_error(path + ": malformed PNG file");
+        }
+        png_init_io(_png, _file);
+        png_read_info(_png, _info);
+        bool interlaced = png_get_interlace_type(_png, _info) != PNG_INTERLACE_NONE;
+        png_set_expand(_png);
+        png_set_strip_16(_png);
+        png_set_strip_alpha(_png);
+        png_read_update_info(_png, _info);
+        _channels = png_get_channels(_png, _info);
+        int64_t w = png_get_image_width(_png, _info);
+        int64_t h = png_get_image_height(_png, _info);
+        if (interlaced) {
+            close();
+            throw std::runtime_error(path + ": interlaced PNG files cannot be streamed");
+        }
+        try {
+            checkSize(path, w, h);
+        } catch (...) {
+            close();
+            throw;
+        }
+        width = static_cast<int>(w);
+        height = static_cast<int>(h);
+        _row.resize(png_get_rowbytes(_png, _info));
+    }
+
+    ~PngDecoder() override {
+        close();
+    }
+
+    void readRow(uint8_t* pixels) override {
+        if (setjmp(png_jmpbuf(_png))) {
+            throw std::runtime_error(_path + ": malformed PNG file");
+        }
+        png_read_row(_png, _row.data(), nullptr);
+        for (int x = 0; x < width; x++) {
+            pixels[x] = _row[size_t(x) * _channels];
+        }
+    }
+
+private:
+    void close() {
+        if (_png) {
+            png_destroy_read_struct(&_png, _info ? &_info : nullptr, nullptr);
+        }
+        if (_file) {
+            std::fclose(_file);
+            _file = nullptr;
+        }
+    }
+
+    std::string _path;
+    std::FILE* _file = nullptr;
+    png_structp _png = nullptr;
+    png_infop _info = nullptr;
+    int _channels = 0;
+    std::vector<uint8_t> _row;
+};
+#endif
+
+bool endsWith(const std::string& path, const char* extension) {
+    std::string lower = path;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lower.ends_with(extension);
+}
+
+} // namespace
+
+ImageStream::ImageStream(const std::string& path) {
+    if (endsWith(path, ".bmp")) {
+        _decoder = std::make_unique<BmpDecoder>(path);
+#ifdef GOL_HAVE_PNG
+    } else if (endsWith(path, ".png")) {
+        _decoder = std::make_unique<PngDecoder>(path);
+#endif
+    } else if (endsWith(path, ".pbm") || endsWith(path, ".pgm") || endsWith(path, ".ppm") || endsWith(path, ".pnm")) {
+        _decoder = std::make_unique<PnmDecoder>(path);
+    } else {
+        throw std::runtime_error(path + ": images of this type cannot be streamed");
+    }
+}
+
+ImageStream::~ImageStream() = default;
+ImageStream::ImageStream(ImageStream&& other) noexcept = default;
+ImageStream& ImageStream::operator=(ImageStream&& other) noexcept = default;
+
+bool ImageStream::supports(const std::string& path) {
+#ifdef GOL_HAVE_PNG
+    if (endsWith(path, ".png")) {
+        return true;
+    }
+#endif
+    return endsWith(path, ".bmp") || endsWith(path, ".pbm") || endsWith(path, ".pgm") || endsWith(path, ".ppm") ||
+           endsWith(path, ".pnm");
+}
+
+int ImageStream::width() const {
+    return _decoder->width;
+}
+
+int ImageStream::height() const {
+    return _decoder->height;
+}
+
+bool ImageStream::bottomUp() const {
+    return _decoder->bottom_up;
+}
+
+void ImageStream::readRow(uint8_t* pixels) {
+    _decoder->readRow(pixels);
+}
+
+ImageBandReader::ImageBandReader(ImageStream stream, int width, int height, int band_rows, int queue_bands)
+    : _stream(std::move(stream)),
+      _width(width),
+      _height(height),
+      _band_rows(band_rows),
+      _queue_bands(queue_bands) {
+    _worker = std::thread(&ImageBandReader::decode, this);
+}
+
+ImageBandReader::~ImageBandReader() {
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _changed.notify_all();
+    _worker.join();
+}
+
+bool ImageBandReader::next(ImageBand& band, bool wait) {
+    std::unique_lock lock(_mutex);
+    if (wait) {
+        _changed.wait(lock, [&] { return !_bands.empty() || _done; });
+    }
+    if (_bands.empty()) {
+        if (_error) {
+            std::exception_ptr error = std::exchange(_error, nullptr);
+            std::rethrow_exception(error);
+        }
+        return false;
+    }
+    band = std::move(_bands.front());
+    _bands.pop_front();
+    lock.unlock();
+    _changed.notify_all();
+    return true;
+}
+
+bool ImageBandReader::finished() {
+    std::lock_guard lock(_mutex);
+    return _done && _bands.empty() && !_error;
+}
+
+void ImageBandReader::decode() {
+    try {
+        int w = _stream.width();
+        int h = _stream.height();
+        int words = (_width + 63) / 64;
+        int offset_x = (_width - w) / 2;
+        int offset_y = (_height - h) / 2;
+        int x_begin = std::max(0, -offset_x);
+        int x_end = std::min(w, _width - offset_x);
+        std::vector<uint8_t> pixels(w);
+        // Rows of the image, in file order, until the last one that lands on the universe
+        for (int row = 0; row < h;) {
+            if (!_stream.bottomUp() && row + offset_y >= _height) {
+                break;
+            }
+            int count = std::min(_band_rows, h - row);
+            ImageBand band;
+            band.words = words;
+            band.bits.assign(size_t(count) * words, 0);
+            int first = -1;
+            int last = -1;
+            for (int i = 0; i < count; i++) {
+                _stream.readRow(pixels.data());
+                int image_y = _stream.bottomUp() ? h - 1 - (row + i) : row + i;
+                int y = image_y + offset_y;
+                if (y < 0 || y >= _height || x_end <= x_begin) {
+                    continue;
+                }
+                // Bottom-up files fill their band from its end, so that it still covers ascending rows
+                int slot = _stream.bottomUp() ? count - 1 - i : i;
+                uint64_t* out = band.bits.data() + size_t(slot) * words;
+                thresholdRowInto(pixels.data() + x_begin, x_end - x_begin, out, x_begin + offset_x);
+                first = first < 0 ? slot : std::min(first, slot);
+                last = std::max(last, slot);
+            }
+            row += count;
+            if (first < 0) {
+                continue;
+            }
+            int top = _stream.bottomUp() ? h - row : row - count;
+            band.y = top + offset_y + first;
+            band.rows = last - first + 1;
+            band.bits.erase(band.bits.begin() + size_t(last + 1) * words, band.bits.end());
+            band.bits.erase(band.bits.begin(), band.bits.begin() + size_t(first) * words);
+
+            std::unique_lock lock(_mutex);
+            _changed.wait(lock, [&] { return _bands.size() < _queue_bands || _stop; });
+            if (_stop) {
+                return;
+            }
+            _bands.push_back(std::move(band));
+            lock.unlock();
+            _changed.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard lock(_mutex);
+        _error = std::current_exception();
+    }
+    {
+        std::lock_guard lock(_mutex);
+        _done = true;
+    }
+    _changed.notify_all();
+}
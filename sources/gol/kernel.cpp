@@ -0,0 +1,142 @@
+#include <algorithm>
+
+#include "gol/kernel.hpp"
+#include "kernel_impl.hpp"
+
+namespace {
+
+void scalarStepRow(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words, const RuleMasks& rules
+) {
+    stepRowWith<ScalarOps>(above, row, below, out, words, rules);
+}
+
+void scalarSoupRow(uint64_t seed, uint32_t threshold, uint32_t y, uint64_t* out, int words) {
+    soupRowWith<ScalarSoupOps>(seed, threshold, y, out, words);
+}
+
+void scalarThresholdRow(const uint8_t* pixels, int count, uint64_t* out) {
+    thresholdRowWith<ScalarThresholdOps>(pixels, count, out);
+}
+
+StepRowFunction stepRowFor(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::Avx512: return avx512StepRow();
+    case KernelIsa::Avx2: return avx2StepRow();
+    case KernelIsa::Sse2: return sse2StepRow();
+    default: return scalarStepRow;
+    }
+}
+
+SoupRowFunction soupRowFor(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::Avx512: return avx512SoupRow();
+    case KernelIsa::Avx2: return avx2SoupRow();
+    case KernelIsa::Sse2: return sse2SoupRow();
+    default: return scalarSoupRow;
+    }
+}
+
+ThresholdRowFunction thresholdRowFor(KernelIsa isa) {
+    // AVX-512F alone has no byte comparisons, the AVX2 version serves it as well
+    ThresholdRowFunction function = nullptr;
+    switch (isa) {
+    case KernelIsa::Avx512:
+    case KernelIsa::Avx2: function = avx2ThresholdRow(); break;
+    case KernelIsa::Sse2: function = sse2ThresholdRow(); break;
+    default: break;
+    }
+    return function ? function : scalarThresholdRow;
+}
+
+bool cpuSupports(KernelIsa isa) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    switch (isa) {
+    case KernelIsa::Avx512: return __builtin_cpu_supports("avx512f");
+    case KernelIsa::Avx2: return __builtin_cpu_supports("avx2");
+    case KernelIsa::Sse2: return __builtin_cpu_supports("sse2");
+    default: return true;
+    }
+#else
+    return isa == KernelIsa::Scalar;
+#endif
+}
+
+struct Dispatch {
+    KernelIsa isa;
+    StepRowFunction function;
+    SoupRowFunction soup;
+    ThresholdRowFunction threshold;
+};
+
+Dispatch widestSupported(KernelIsa limit) {
+    for (int i = static_cast<int>(limit); i > 0; i--) {
+        auto isa = static_cast<KernelIsa>(i);
+        if (cpuSupports(isa) && stepRowFor(isa)) {
+            return {isa, stepRowFor(isa), soupRowFor(isa), thresholdRowFor(isa)};
+        }
+    }
+    return {KernelIsa::Scalar, scalarStepRow, scalarSoupRow, scalarThresholdRow};
+}
+
+Dispatch& dispatch() {
+    static Dispatch current = widestSupported(KernelIsa::Avx512);
+    return current;
+}
+
+} // namespace
+
+KernelIsa detectKernelIsa() {
+    return widestSupported(KernelIsa::Avx512).isa;
+}
+
+KernelIsa kernelIsa() {
+    return dispatch().isa;
+}
+
+void setKernelIsa(KernelIsa isa) {
+    dispatch() = widestSupported(isa);
+}
+
+const char* kernelIsaName(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::Scalar: return "scalar";
+    case KernelIsa::Sse2: return "sse2";
+    case KernelIsa::Avx2: return "avx2";
+    case KernelIsa::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+void stepRow(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words, const RuleMasks& rules
+) {
+    dispatch().function(above, row, below, out, words, rules);
+}
+
+void soupRow(uint64_t seed, uint32_t threshold, uint32_t y, uint64_t* out, int words) {
+    dispatch().soup(seed, threshold, y, out, words);
+}
+
+void thresholdRow(const uint8_t* pixels, int count, uint64_t* out) {
+    dispatch().threshold(pixels, count, out);
+}
+
+void thresholdRowInto(const uint8_t* pixels, int count, uint64_t* row, int x) {
+    // Chunks keep the packed bits on the stack, a whole number of words so that every chunk has the same shift
+    constexpr int CHUNK = 64 * 64;
+    uint64_t bits[CHUNK / 64];
+    int shift = x % 64;
+    row += x / 64;
+    for (int done = 0; done < count; done += CHUNK) {
+        int n = std::min(CHUNK, count - done);
+        thresholdRow(pixels + done, n, bits);
+        uint64_t* out = row + done / 64;
+        for (int i = 0; i * 64 < n; i++) {
+            out[i] |= bits[i] << shift;
+            if (shift && bits[i] >> (64 - shift)) {
+                out[i + 1] |= bits[i] >> (64 - shift);
+            }
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#include "kernel_impl.hpp"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Ops {
+    using Reg = __m256i;
+    static constexpr int LANES = 4;
+    static Reg load(const uint64_t* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    static void store(uint64_t* p, Reg v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    static Reg zero() {
+        return _mm256_setzero_si256();
+    }
+    static Reg bitAnd(Reg a, Reg b) {
+        return _mm256_and_si256(a, b);
+    }
+    static Reg bitOr(Reg a, Reg b) {
+        return _mm256_or_si256(a, b);
+    }
+    static Reg bitXor(Reg a, Reg b) {
+        return _mm256_xor_si256(a, b);
+    }
+    static Reg bitNot(Reg a) {
+        return _mm256_xor_si256(a, _mm256_set1_epi32(-1));
+    }
+    static Reg shiftLeft1(Reg a) {
+        return _mm256_slli_epi64(a, 1);
+    }
+    static Reg shiftRight1(Reg a) {
+        return _mm256_srli_epi64(a, 1);
+    }
+    static Reg shiftLeft63(Reg a) {
+        return _mm256_slli_epi64(a, 63);
+    }
+    static Reg shiftRight63(Reg a) {
+        return _mm256_srli_epi64(a, 63);
+    }
+};
+
+struct Avx2SoupOps {
+    using Reg = __m256i;
+    static constexpr int LANES = 8;
+    static Reg broadcast(uint32_t value) {
+        return _mm256_set1_epi32(static_cast<int>(value));
+    }
+    static Reg counters(uint32_t first) {
+        return _mm256_add_epi32(broadcast(first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+    static Reg bitXor(Reg a, Reg b) {
+        return _mm256_xor_si256(a, b);
+    }
+    static void mulHiLo(Reg a, uint32_t b, Reg& hi, Reg& lo) {
+        // 64 bit products of the even lanes, then of the odd ones
+        Reg factor = broadcast(b);
+        Reg even = _mm256_mul_epu32(a, factor);
+        Reg odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), factor);
+        lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+        hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    }
+    static void below(Reg a, uint32_t threshold, uint32_t& low, uint32_t& high) {
+        // Unsigned 16 bit comparison as a signed one with both sign bits flipped, then one byte mask bit out of
+        // every two per half
+        Reg sign = _mm256_set1_epi16(static_cast<short>(0x8000));
+        Reg less =
+            _mm256_cmpgt_epi16(_mm256_set1_epi16(static_cast<short>(threshold ^ 0x8000)), _mm256_xor_si256(a, sign));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(less));
+        auto every_fourth = [](uint32_t bits) {
+            bits &= 0x11111111;
+            bits = (bits | bits >> 3) & 0x03030303;
+            bits = (bits | bits >> 6) & 0x000F000F;
+            return (bits | bits >> 12) & 0x00FF;
+        };
+        low = every_fourth(mask);
+        high = every_fourth(mask >> 2);
+    }
+};
+
+struct Avx2ThresholdOps {
+    static constexpr int BYTES = 32;
+    static uint64_t nonZero(const uint8_t* pixels) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));
+        return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_setzero_si256())));
+    }
+};
+
+void stepRowAvx2(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words, const RuleMasks& rules
+) {
+    stepRowWith<Avx2Ops>(above, row, below, out, words, rules);
+}
+
+void soupRowAvx2(uint64_t seed, uint32_t threshold, uint32_t y, uint64_t* out, int words) {
+    soupRowWith<Avx2SoupOps>(seed, threshold, y, out, words);
+}
+
+void thresholdRowAvx2(const uint8_t* pixels, int count, uint64_t* out) {
+    thresholdRowWith<Avx2ThresholdOps>(pixels, count, out);
+}
+
+} // namespace
+
+StepRowFunction avx2StepRow() {
+    return stepRowAvx2;
+}
+
+SoupRowFunction avx2SoupRow() {
+    return soupRowAvx2;
+}
+
+ThresholdRowFunction avx2ThresholdRow() {
+    return thresholdRowAvx2;
+}
+#else
+StepRowFunction avx2StepRow() {
+    return nullptr;
+}
+
+SoupRowFunction avx2SoupRow() {
+    return nullptr;
+}
+
+ThresholdRowFunction avx2ThresholdRow() {
+    return nullptr;
+}
+#endif
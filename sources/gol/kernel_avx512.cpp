@@ -0,0 +1,103 @@
+#include "kernel_impl.hpp"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+
+namespace {
+
+struct Avx512Ops {
+    using Reg = __m512i;
+    static constexpr int LANES = 8;
+    static Reg load(const uint64_t* p) {
+        return _mm512_loadu_si512(p);
+    }
+    static void store(uint64_t* p, Reg v) {
+        _mm512_storeu_si512(p, v);
+    }
+    static Reg zero() {
+        return _mm512_setzero_si512();
+    }
+    static Reg bitAnd(Reg a, Reg b) {
+        return _mm512_and_si512(a, b);
+    }
+    static Reg bitOr(Reg a, Reg b) {
+        return _mm512_or_si512(a, b);
+    }
+    static Reg bitXor(Reg a, Reg b) {
+        return _mm512_xor_si512(a, b);
+    }
+    static Reg bitNot(Reg a) {
+        return _mm512_ternarylogic_epi64(a, a, a, 0x55);
+    }
+    static Reg shiftLeft1(Reg a) {
+        return _mm512_slli_epi64(a, 1);
+    }
+    static Reg shiftRight1(Reg a) {
+        return _mm512_srli_epi64(a, 1);
+    }
+    static Reg shiftLeft63(Reg a) {
+        return _mm512_slli_epi64(a, 63);
+    }
+    static Reg shiftRight63(Reg a) {
+        return _mm512_srli_epi64(a, 63);
+    }
+};
+
+struct Avx512SoupOps {
+    using Reg = __m512i;
+    static constexpr int LANES = 16;
+    static Reg broadcast(uint32_t value) {
+        return _mm512_set1_epi32(static_cast<int>(value));
+    }
+    static Reg counters(uint32_t first) {
+        return _mm512_add_epi32(
+            broadcast(first), _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+        );
+    }
+    static Reg bitXor(Reg a, Reg b) {
+        return _mm512_xor_si512(a, b);
+    }
+    static void mulHiLo(Reg a, uint32_t b, Reg& hi, Reg& lo) {
+        // 64 bit products of the even lanes, then of the odd ones
+        Reg factor = broadcast(b);
+        Reg even = _mm512_mul_epu32(a, factor);
+        Reg odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), factor);
+        lo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+        hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+    }
+    static void below(Reg a, uint32_t threshold, uint32_t& low, uint32_t& high) {
+        // 32 bit comparisons of each half, 16 bit ones would need AVX-512BW
+        Reg limit = broadcast(threshold);
+        low = _mm512_cmplt_epu32_mask(_mm512_and_si512(a, broadcast(0xFFFF)), limit);
+        high = _mm512_cmplt_epu32_mask(_mm512_srli_epi32(a, 16), limit);
+    }
+};
+
+void stepRowAvx512(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words, const RuleMasks& rules
+) {
+    stepRowWith<Avx512Ops>(above, row, below, out, words, rules);
+}
+
+void soupRowAvx512(uint64_t seed, uint32_t threshold, uint32_t y, uint64_t* out, int words) {
+    soupRowWith<Avx512SoupOps>(seed, threshold, y, out, words);
+}
+
+} // namespace
+
+StepRowFunction avx512StepRow() {
+    return stepRowAvx512;
+}
+
+SoupRowFunction avx512SoupRow() {
+    return soupRowAvx512;
+}
+#else
+StepRowFunction avx512StepRow() {
+    return nullptr;
+}
+
+SoupRowFunction avx512SoupRow() {
+    return nullptr;
+}
+#endif
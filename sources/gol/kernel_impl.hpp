@@ -0,0 +1,265 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#include "gol/kernel.hpp"
+
+using StepRowFunction = void (*)(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words, const RuleMasks& rules
+);
+
+using SoupRowFunction = void (*)(uint64_t seed, uint32_t threshold, uint32_t y, uint64_t* out, int words);
+
+using ThresholdRowFunction = void (*)(const uint8_t* pixels, int count, uint64_t* out);
+
+// Entry points of the ISA specific translation units, null when the compiler could not target that ISA
+StepRowFunction sse2StepRow();
+StepRowFunction avx2StepRow();
+StepRowFunction avx512StepRow();
+SoupRowFunction sse2SoupRow();
+SoupRowFunction avx2SoupRow();
+SoupRowFunction avx512SoupRow();
+ThresholdRowFunction sse2ThresholdRow();
+ThresholdRowFunction avx2ThresholdRow();
+
+// Everything below lives in an unnamed namespace: each ISA translation unit instantiates it with different
+// compiler flags, and sharing a symbol between them would let the linker pick an AVX build for the scalar path.
+namespace {
+
+struct ScalarOps {
+    using Reg = uint64_t;
+    static constexpr int LANES = 1;
+    static Reg load(const uint64_t* p) {
+        return *p;
+    }
+    static void store(uint64_t* p, Reg v) {
+        *p = v;
+    }
+    static Reg zero() {
+        return 0;
+    }
+    static Reg bitAnd(Reg a, Reg b) {
+        return a & b;
+    }
+    static Reg bitOr(Reg a, Reg b) {
+        return a | b;
+    }
+    static Reg bitXor(Reg a, Reg b) {
+        return a ^ b;
+    }
+    static Reg bitNot(Reg a) {
+        return ~a;
+    }
+    // Cells moved one column east / west within each 64 bit lane
+    static Reg shiftLeft1(Reg a) {
+        return a << 1;
+    }
+    static Reg shiftRight1(Reg a) {
+        return a >> 1;
+    }
+    static Reg shiftLeft63(Reg a) {
+        return a << 63;
+    }
+    static Reg shiftRight63(Reg a) {
+        return a >> 63;
+    }
+};
+
+template <class Ops>
+inline void fullAdd(
+    typename Ops::Reg a, typename Ops::Reg b, typename Ops::Reg c, typename Ops::Reg& sum, typename Ops::Reg& carry
+) {
+    auto ab = Ops::bitXor(a, b);
+    sum = Ops::bitXor(ab, c);
+    carry = Ops::bitOr(Ops::bitAnd(a, b), Ops::bitAnd(ab, c));
+}
+
+// Bit-sliced count of the eight neighbors of Ops::LANES words of cells at once, as four bit planes
+// (count = s0 + 2 s1 + 4 s2 + 8 s3), then the rule masks resolved as a few and/or per neighbor count
+template <class Ops>
+inline typename Ops::Reg nextCells(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, int i, const RuleMasks& rules
+) {
+    using Reg = typename Ops::Reg;
+    auto west = [&](const uint64_t* r) {
+        return Ops::bitOr(Ops::shiftLeft1(Ops::load(r + i)), Ops::shiftRight63(Ops::load(r + i - 1)));
+    };
+    auto east = [&](const uint64_t* r) {
+        return Ops::bitOr(Ops::shiftRight1(Ops::load(r + i)), Ops::shiftLeft63(Ops::load(r + i + 1)));
+    };
+
+    Reg sum_above, carry_above;
+    fullAdd<Ops>(west(above), Ops::load(above + i), east(above), sum_above, carry_above);
+    Reg sum_below, carry_below;
+    fullAdd<Ops>(west(below), Ops::load(below + i), east(below), sum_below, carry_below);
+    Reg center = Ops::load(row + i);
+    Reg row_west = west(row);
+    Reg row_east = east(row);
+    Reg sum_middle = Ops::bitXor(row_west, row_east);
+    Reg carry_middle = Ops::bitAnd(row_west, row_east);
+
+    Reg s0, ones_carry;
+    fullAdd<Ops>(sum_above, sum_below, sum_middle, s0, ones_carry);
+    Reg twos, twos_carry;
+    fullAdd<Ops>(carry_above, carry_below, carry_middle, twos, twos_carry);
+    Reg s1 = Ops::bitXor(twos, ones_carry);
+    Reg fours = Ops::bitAnd(twos, ones_carry);
+    Reg s2 = Ops::bitXor(twos_carry, fours);
+    Reg s3 = Ops::bitAnd(twos_carry, fours);
+
+    Reg planes[4][2] = {
+        {Ops::bitNot(s0), s0},
+        {Ops::bitNot(s1), s1},
+        {Ops::bitNot(s2), s2},
+        {Ops::bitNot(s3), s3},
+    };
+    Reg birth = Ops::zero();
+    Reg keep = Ops::zero();
+    for (int n = 0; n < RULE_COUNT; n++) {
+        if (!((rules.birth | rules.keep) >> n & 1)) {
+            continue;
+        }
+        Reg is_n = Ops::bitAnd(
+            Ops::bitAnd(planes[0][n & 1], planes[1][n >> 1 & 1]), Ops::bitAnd(planes[2][n >> 2 & 1], planes[3][n >> 3])
+        );
+        if (rules.birth >> n & 1) {
+            birth = Ops::bitOr(birth, is_n);
+        } else {
+            keep = Ops::bitOr(keep, is_n);
+        }
+    }
+    return Ops::bitOr(birth, Ops::bitAnd(keep, center));
+}
+
+template <class Ops>
+inline void stepRowWith(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words, const RuleMasks& rules
+) {
+    int i = 0;
+    for (; i + Ops::LANES <= words; i += Ops::LANES) {
+        Ops::store(out + i, nextCells<Ops>(above, row, below, i, rules));
+    }
+    for (; i < words; i++) {
+        out[i] = nextCells<ScalarOps>(above, row, below, i, rules);
+    }
+}
+
+// Philox4x32-10 on Ops::LANES consecutive blocks at once, one per 32-bit lane
+struct ScalarSoupOps {
+    using Reg = uint32_t;
+    static constexpr int LANES = 1;
+    static Reg broadcast(uint32_t value) {
+        return value;
+    }
+    static Reg counters(uint32_t first) {
+        return first;
+    }
+    static Reg bitXor(Reg a, Reg b) {
+        return a ^ b;
+    }
+    static void mulHiLo(Reg a, uint32_t b, Reg& hi, Reg& lo) {
+        uint64_t product = uint64_t(a) * b;
+        hi = uint32_t(product >> 32);
+        lo = uint32_t(product);
+    }
+    // Bit i set when the low (resp. high) 16 bits of lane i are below the threshold, from 1 to 65535
+    static void below(Reg a, uint32_t threshold, uint32_t& low, uint32_t& high) {
+        low = (a & 0xFFFF) < threshold;
+        high = (a >> 16) < threshold;
+    }
+};
+
+// Bits 0 to 7 moved to bits 0, 8, ..., 56
+inline uint64_t spreadToBytes(uint64_t bits) {
+    bits = (bits | bits << 28) & 0x0000000F0000000F;
+    bits = (bits | bits << 14) & 0x0003000300030003;
+    return (bits | bits << 7) & 0x0101010101010101;
+}
+
+// Blocks [block, block + Ops::LANES) of soup row y, or'ed into `out`: cell x is lane x % 8 of block x / 8, the low
+// half of word (x % 8) / 2 first, and is alive below the threshold (RandomNumberGenerator::soupBlock())
+template <class Ops>
+inline void soupBlocks(uint64_t seed, uint32_t threshold, uint32_t y, uint32_t block, uint64_t* out) {
+    using Reg = typename Ops::Reg;
+    Reg c0 = Ops::counters(block);
+    Reg c1 = Ops::broadcast(y);
+    Reg c2 = Ops::broadcast(0);
+    Reg c3 = Ops::broadcast(0);
+    uint32_t key0 = uint32_t(seed);
+    uint32_t key1 = uint32_t(seed >> 32);
+    for (int i = 0; i < 10; i++) {
+        Reg hi0, lo0, hi1, lo1;
+        Ops::mulHiLo(c0, 0xD2511F53u, hi0, lo0);
+        Ops::mulHiLo(c2, 0xCD9E8D57u, hi1, lo1);
+        c0 = Ops::bitXor(Ops::bitXor(hi1, c1), Ops::broadcast(key0));
+        c1 = lo1;
+        c2 = Ops::bitXor(Ops::bitXor(hi0, c3), Ops::broadcast(key1));
+        c3 = lo0;
+        key0 += 0x9E3779B9u;
+        key1 += 0xBB67AE85u;
+    }
+    Reg words[4] = {c0, c1, c2, c3};
+    for (int k = 0; k < 4; k++) {
+        uint32_t below[2];
+        Ops::below(words[k], threshold, below[0], below[1]);
+        for (int half = 0; half < 2; half++) {
+            for (int part = 0; part < Ops::LANES; part += 8) {
+                uint32_t first = block + part;
+                out[first / 8] |= spreadToBytes(below[half] >> part & 0xFF) << ((first % 8) * 8 + 2 * k + half);
+            }
+        }
+    }
+}
+
+template <class Ops>
+inline void soupRowWith(uint64_t seed, uint32_t threshold, uint32_t y, uint64_t* out, int words) {
+    for (int i = 0; i < words; i++) {
+        out[i] = threshold > 0xFFFF ? ~uint64_t(0) : 0;
+    }
+    if (threshold == 0 || threshold > 0xFFFF) {
+        return;
+    }
+    uint32_t blocks = uint32_t(words) * 8;
+    uint32_t block = 0;
+    for (; block + Ops::LANES <= blocks; block += Ops::LANES) {
+        soupBlocks<Ops>(seed, threshold, y, block, out);
+    }
+    for (; block < blocks; block++) {
+        soupBlocks<ScalarSoupOps>(seed, threshold, y, block, out);
+    }
+}
+
+// Ops::BYTES pixels at once, nonZero() giving one bit per pixel
+struct ScalarThresholdOps {
+    static constexpr int BYTES = 8;
+    static uint64_t nonZero(const uint8_t* pixels) {
+        uint64_t bytes;
+        std::memcpy(&bytes, pixels, sizeof(bytes));
+        // Any bit of a byte folded into its lowest, then bit 8 * i gathered to bit i by a carry free multiplication
+        bytes |= bytes >> 4;
+        bytes |= bytes >> 2;
+        bytes |= bytes >> 1;
+        return (bytes & 0x0101010101010101) * 0x0102040810204080 >> 56;
+    }
+};
+
+template <class Ops>
+inline void thresholdRowWith(const uint8_t* pixels, int count, uint64_t* out) {
+    int x = 0;
+    for (; x + 64 <= count; x += 64) {
+        uint64_t word = 0;
+        for (int part = 0; part < 64; part += Ops::BYTES) {
+            word |= Ops::nonZero(pixels + x + part) << part;
+        }
+        out[x / 64] = word;
+    }
+    if (x < count) {
+        uint64_t word = 0;
+        for (int i = x; i < count; i++) {
+            word |= uint64_t(pixels[i] != 0) << (i - x);
+        }
+        out[x / 64] = word;
+    }
+}
+
+} // namespace
@@ -0,0 +1,130 @@
+#include "kernel_impl.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2Ops {
+    using Reg = __m128i;
+    static constexpr int LANES = 2;
+    static Reg load(const uint64_t* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    static void store(uint64_t* p, Reg v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+    static Reg zero() {
+        return _mm_setzero_si128();
+    }
+    static Reg bitAnd(Reg a, Reg b) {
+        return _mm_and_si128(a, b);
+    }
+    static Reg bitOr(Reg a, Reg b) {
+        return _mm_or_si128(a, b);
+    }
+    static Reg bitXor(Reg a, Reg b) {
+        return _mm_xor_si128(a, b);
+    }
+    static Reg bitNot(Reg a) {
+        return _mm_xor_si128(a, _mm_set1_epi32(-1));
+    }
+    static Reg shiftLeft1(Reg a) {
+        return _mm_slli_epi64(a, 1);
+    }
+    static Reg shiftRight1(Reg a) {
+        return _mm_srli_epi64(a, 1);
+    }
+    static Reg shiftLeft63(Reg a) {
+        return _mm_slli_epi64(a, 63);
+    }
+    static Reg shiftRight63(Reg a) {
+        return _mm_srli_epi64(a, 63);
+    }
+};
+
+struct Sse2SoupOps {
+    using Reg = __m128i;
+    static constexpr int LANES = 4;
+    static Reg broadcast(uint32_t value) {
+        return _mm_set1_epi32(static_cast<int>(value));
+    }
+    static Reg counters(uint32_t first) {
+        return _mm_add_epi32(broadcast(first), _mm_setr_epi32(0, 1, 2, 3));
+    }
+    static Reg bitXor(Reg a, Reg b) {
+        return _mm_xor_si128(a, b);
+    }
+    static void mulHiLo(Reg a, uint32_t b, Reg& hi, Reg& lo) {
+        // 64 bit products of the even lanes, then of the odd ones
+        Reg factor = broadcast(b);
+        Reg even = _mm_mul_epu32(a, factor);
+        Reg odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), factor);
+        Reg low_words = _mm_set1_epi64x(0xFFFFFFFF);
+        lo = _mm_or_si128(_mm_and_si128(even, low_words), _mm_slli_epi64(odd, 32));
+        hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(low_words, odd));
+    }
+    static void below(Reg a, uint32_t threshold, uint32_t& low, uint32_t& high) {
+        // Unsigned 16 bit comparison as a signed one with both sign bits flipped, then one byte mask bit out of
+        // every two per half
+        Reg sign = _mm_set1_epi16(static_cast<short>(0x8000));
+        Reg less = _mm_cmpgt_epi16(_mm_set1_epi16(static_cast<short>(threshold ^ 0x8000)), _mm_xor_si128(a, sign));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(less));
+        auto every_fourth = [](uint32_t bits) {
+            bits &= 0x1111;
+            bits = (bits | bits >> 3) & 0x0303;
+            return (bits | bits >> 6) & 0x000F;
+        };
+        low = every_fourth(mask);
+        high = every_fourth(mask >> 2);
+    }
+};
+
+struct Sse2ThresholdOps {
+    static constexpr int BYTES = 16;
+    static uint64_t nonZero(const uint8_t* pixels) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+        return ~_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())) & 0xFFFF;
+    }
+};
+
+void stepRowSse2(
+    const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out, int words, const RuleMasks& rules
+) {
+    stepRowWith<Sse2Ops>(above, row, below, out, words, rules);
+}
+
+void soupRowSse2(uint64_t seed, uint32_t threshold, uint32_t y, uint64_t* out, int words) {
+    soupRowWith<Sse2SoupOps>(seed, threshold, y, out, words);
+}
+
+void thresholdRowSse2(const uint8_t* pixels, int count, uint64_t* out) {
+    thresholdRowWith<Sse2ThresholdOps>(pixels, count, out);
+}
+
+} // namespace
+
+StepRowFunction sse2StepRow() {
+    return stepRowSse2;
+}
+
+SoupRowFunction sse2SoupRow() {
+    return soupRowSse2;
+}
+
+ThresholdRowFunction sse2ThresholdRow() {
+    return thresholdRowSse2;
+}
+#else
+StepRowFunction sse2StepRow() {
+    return nullptr;
+}
+
+SoupRowFunction sse2SoupRow() {
+    return nullptr;
+}
+
+ThresholdRowFunction sse2ThresholdRow() {
+    return nullptr;
+}
+#endif
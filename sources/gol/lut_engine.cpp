@@ -0,0 +1,112 @@
+#include <bit>
+#include <chrono>
+#include <utility>
+
+#include "gol/lut_engine.hpp"
+
+void buildBlockTable(const RuleMasks& rules, BlockTable& table) {
+    // Next state of a single cell from its 3x3 neighborhood, rows of three bits with the cell in bit 4
+    uint8_t cell[512];
+    for (int window = 0; window < 512; window++) {
+        bool alive = window >> 4 & 1;
+        cell[window] = applyRule(rules, std::popcount(static_cast<unsigned>(window & ~0x10)), alive);
+    }
+    for (int index = 0; index < 65536; index++) {
+        auto window = [&](int x, int y) {
+            int bits = 0;
+            for (int row = 0; row < 3; row++) {
+                bits |= (index >> ((y + row) * 4 + x) & 7) << (row * 3);
+            }
+            return cell[bits];
+        };
+        table[index] = window(0, 0) | window(1, 0) << 1 | window(0, 1) << 2 | window(1, 1) << 3;
+    }
+}
+
+LutEngine::LutEngine(int width, int height, int threads)
+    : _current(width, height),
+      _next(width, height),
+      _table(std::make_unique<BlockTable>()),
+      _pool(std::make_unique<ThreadPool>(threads)) {
+    const int conway[RULE_COUNT] = {0, 0, 2, 1, 0, 0, 0, 0, 0};
+    setRules(conway);
+}
+
+void LutEngine::setRules(const int rules[RULE_COUNT]) {
+    setRules(compileRules(rules));
+}
+
+void LutEngine::setRules(const RuleMasks& rules) {
+    _rules = rules;
+    buildBlockTable(_rules, *_table);
+}
+
+void LutEngine::step(int generations) {
+    auto start = std::chrono::steady_clock::now();
+    _current.fillHalo();
+    int block_rows = (height() + 1) / 2;
+    for (int g = 0; g < generations; g++) {
+        _pool->parallelFor(block_rows, [this](int block_row) { stepBlockRow(block_row * 2); });
+        std::swap(_current, _next);
+        _generation++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (generations > 0 && seconds > 0) {
+        _cells_per_second = static_cast<double>(width()) * height() * generations / seconds;
+    }
+}
+
+void LutEngine::stepBlockRow(int y) {
+    int height = this->height();
+    int words = _current.words();
+    const uint64_t* rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = _current.row((y + i - 1 + height) % height);
+    }
+    // With an odd height the last block row only has its top row inside the grid
+    bool bottom = y + 1 < height;
+    uint64_t* out_top = _next.row(y);
+    uint64_t* out_bottom = bottom ? _next.row(y + 1) : nullptr;
+
+    for (int i = 0; i < words; i++) {
+        // Cells -1 to 62 of the word, then 62 to 65 for the last block
+        uint64_t low[4];
+        uint64_t high[4];
+        for (int r = 0; r < 4; r++) {
+            low[r] = rows[r][i] << 1 | rows[r][i - 1] >> 63;
+            high[r] = rows[r][i] >> 61 | rows[r][i + 1] << 3;
+        }
+        uint64_t top = 0;
+        uint64_t bottom_bits = 0;
+        for (int block = 0; block < 32; block++) {
+            int shift = block * 2;
+            unsigned index;
+            if (block < 31) {
+                index = (low[0] >> shift & 15) | (low[1] >> shift & 15) << 4 | (low[2] >> shift & 15) << 8 |
+                        (low[3] >> shift & 15) << 12;
+            } else {
+                index = (high[0] & 15) | (high[1] & 15) << 4 | (high[2] & 15) << 8 | (high[3] & 15) << 12;
+            }
+            uint64_t next = (*_table)[index];
+            top |= (next & 3) << shift;
+            bottom_bits |= (next >> 2) << shift;
+        }
+        out_top[i] = top;
+        if (bottom) {
+            out_bottom[i] = bottom_bits;
+        }
+    }
+
+    // Leftovers past the last cell become padding again, then this block row owns its guard words
+    out_top[words - 1] &= _current.lastWordMask();
+    _next.fillHalo(y);
+    if (bottom) {
+        out_bottom[words - 1] &= _current.lastWordMask();
+        _next.fillHalo(y + 1);
+    }
+}
+
+void LutEngine::clear() {
+    _current.clear();
+    _generation = 0;
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gol/macrocell.hpp"
+
+namespace {
+
+using NodeId = HashLife::NodeId;
+
+// Node of 2^level cells a side with its top left corner at (x, y) of an 8x8 leaf, bit y * 8 + x of `cells`
+NodeId leafNode(HashLife& life, uint64_t cells, int level, int x, int y) {
+    if (level == 0) {
+        return cells >> (y * 8 + x) & 1 ? HashLife::ALIVE : HashLife::DEAD;
+    }
+    int half = 1 << (level - 1);
+    return life.join(
+        leafNode(life, cells, level - 1, x, y), leafNode(life, cells, level - 1, x + half, y),
+        leafNode(life, cells, level - 1, x, y + half), leafNode(life, cells, level - 1, x + half, y + half)
+    );
+}
+
+bool leafCell(const HashLife& life, NodeId node, int x, int y) {
+    for (int half = 4; half > 0; half /= 2) {
+        node = life.child(node, (x >= half) + 2 * (y >= half));
+        x &= half - 1;
+        y &= half - 1;
+    }
+    return node == HashLife::ALIVE;
+}
+
+// Whitespace separated unsigned numbers of a node line, false when there are not exactly `count`
+bool parseNumbers(const std::string& line, uint64_t* numbers, int count) {
+    const char* at = line.data();
+    const char* end = line.data() + line.size();
+    for (int i = 0; i < count; i++) {
+        while (at < end && (*at == ' ' || *at == '\t')) {
+            at++;
+        }
+        auto [next, error] = std::from_chars(at, end, numbers[i]);
+        if (error != std::errc()) {
+            return false;
+        }
+        at = next;
+    }
+    while (at < end && (*at == ' ' || *at == '\t')) {
+        at++;
+    }
+    return at == end;
+}
+
+} // namespace
+
+HashLife macrocellStore() {
+    int rules[RULE_COUNT];
+    parseRule("B3/S23", rules);
+    return HashLife(rules);
+}
+
+MacrocellHeader readMacrocell(std::istream& in, HashLife& life) {
+    MacrocellHeader header;
+    std::string line;
+    if (!std::getline(in, line) || !line.starts_with("[M2]")) {
+        throw std::runtime_error("Not a Macrocell file, expected [M2] on the first line");
+    }
+    // Node n of the file, 0 standing for the empty node of whatever level its parent needs
+    std::vector<NodeId> nodes = {HashLife::DEAD};
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        if (line[0] == '#') {
+            std::string value = line.substr(std::min<size_t>(line.size(), 2));
+            value.erase(0, value.find_first_not_of(" \t"));
+            if (line.starts_with("#R")) {
+                header.has_rule = parsePatternRule(value, header.rules);
+            } else if (line.starts_with("#G")) {
+                std::from_chars(value.data(), value.data() + value.size(), header.generation);
+            }
+            continue;
+        }
+
+        if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+            uint64_t cells = 0;
+            int x = 0;
+            int y = 0;
+            for (char c : line) {
+                if (c == '$') {
+                    x = 0;
+                    y++;
+                    continue;
+                }
+                if ((c != '.' && c != '*') || x >= 8 || y >= 8) {
+                    throw std::runtime_error("Malformed Macrocell leaf: " + line);
+                }
+                cells |= uint64_t(c == '*') << (y * 8 + x);
+                x++;
+            }
+            nodes.push_back(leafNode(life, cells, 3, 0, 0));
+            continue;
+        }
+
+        uint64_t numbers[5];
+        if (!parseNumbers(line, numbers, 5) || numbers[0] < 1 || numbers[0] > HashLife::MAX_LEVEL) {
+            throw std::runtime_error("Malformed Macrocell node: " + line);
+        }
+        int level = static_cast<int>(numbers[0]);
+        NodeId children[4];
+        for (int i = 0; i < 4; i++) {
+            uint64_t id = numbers[i + 1];
+            if (level == 1) {
+                // Multi-state files build from level 1 nodes of cell states, anything but 0 is alive here
+                children[i] = id ? HashLife::ALIVE : HashLife::DEAD;
+            } else if (id == 0) {
+                children[i] = life.empty(level - 1);
+            } else if (id < nodes.size() && life.level(nodes[id]) == level - 1) {
+                children[i] = nodes[id];
+            } else {
+                throw std::runtime_error("Macrocell node refers to a missing node or one of the wrong size: " + line);
+            }
+        }
+        nodes.push_back(life.join(children[0], children[1], children[2], children[3]));
+    }
+    life.setRoot(nodes.size() > 1 ? nodes.back() : life.empty(3));
+    life.setGeneration(header.generation);
+    return header;
+}
+
+void writeMacrocell(std::ostream& out, const HashLife& life, const int rules[RULE_COUNT]) {
+    out << "[M2] (ai-tp)\n#R " << formatRule(rules) << '\n';
+    if (life.generation() > 0) {
+        out << "#G " << life.generation() << '\n';
+    }
+    std::unordered_map<NodeId, uint64_t> ids;
+    uint64_t next_id = 1;
+    std::string line;
+    auto write = [&](auto& self, NodeId node) -> uint64_t {
+        int level = life.level(node);
+        if (node == life.empty(level)) {
+            return 0;
+        }
+        if (auto it = ids.find(node); it != ids.end()) {
+            return it->second;
+        }
+        line.clear();
+        if (level == 3) {
+            // Trailing dead cells of a row and trailing empty rows are left out
+            size_t used = 0;
+            for (int y = 0; y < 8; y++) {
+                for (int x = 0; x < 8; x++) {
+                    line += leafCell(life, node, x, y) ? '*' : '.';
+                }
+                line.erase(line.find_last_not_of('.') + 1);
+                line += '$';
+                if (line.size() > 1 && line[line.size() - 2] != '$') {
+                    used = line.size();
+                }
+            }
+            line.resize(used);
+        } else {
+            uint64_t children[4];
+            for (int i = 0; i < 4; i++) {
+                children[i] = self(self, life.child(node, i));
+            }
+            line = std::to_string(level);
+            for (uint64_t child : children) {
+                line += ' ' + std::to_string(child);
+            }
+        }
+        out << line << '\n';
+        ids.emplace(node, next_id);
+        return next_id++;
+    };
+    if (write(write, life.root()) == 0) {
+        // An empty universe is a single empty leaf
+        out << "$\n";
+    }
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <stdexcept>
+#include <string>
+
+#include "gol/rle.hpp"
+
+namespace {
+
+// Value of `key = value` in the header line, empty when missing
+std::string headerValue(const std::string& line, const std::string& key) {
+    size_t at = 0;
+    while ((at = line.find(key, at)) != std::string::npos) {
+        bool starts_item = at == 0 || line[at - 1] == ',' || std::isspace(static_cast<unsigned char>(line[at - 1]));
+        size_t equal = line.find_first_not_of(" \t", at + key.size());
+        if (starts_item && equal != std::string::npos && line[equal] == '=') {
+            size_t begin = line.find_first_not_of(" \t", equal + 1);
+            size_t end = line.find(',', equal);
+            if (begin == std::string::npos || begin >= end) {
+                return "";
+            }
+            std::string value = line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+            return value.substr(0, value.find_last_not_of(" \t\r") + 1);
+        }
+        at += key.size();
+    }
+    return "";
+}
+
+// Sets cells [begin, end) of a packed row
+void fillRun(uint64_t* row, int64_t begin, int64_t end) {
+    while (begin < end) {
+        int64_t word = begin >> 6;
+        int64_t word_end = std::min(end, (word + 1) << 6);
+        int bits = static_cast<int>(word_end - begin);
+        uint64_t mask = bits == 64 ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1) << (begin & 63);
+        row[word] |= mask;
+        begin = word_end;
+    }
+}
+
+// First cell at or after x that is alive (resp. dead), or `width`
+int nextCell(const uint64_t* row, int x, int width, bool alive) {
+    while (x < width) {
+        uint64_t word = alive ? row[x >> 6] : ~row[x >> 6];
+        word &= ~uint64_t(0) << (x & 63);
+        if (word) {
+            return std::min(width, (x & ~63) + std::countr_zero(word));
+        }
+        x = (x & ~63) + 64;
+    }
+    return width;
+}
+
+} // namespace
+
+RleReader::RleReader(std::istream& in) : _in(in) {
+    std::string line;
+    while (std::getline(_in, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        std::string x = headerValue(line, "x");
+        std::string y = headerValue(line, "y");
+        if (x.empty() || y.empty()) {
+            throw std::runtime_error("RLE header line missing x = ..., y = ...");
+        }
+        _header.width = std::stoll(x);
+        _header.height = std::stoll(y);
+        if (_header.width < 0 || _header.height < 0) {
+            throw std::runtime_error("Negative RLE pattern size");
+        }
+        std::string rule = headerValue(line, "rule");
+        _header.has_rule = !rule.empty() && parsePatternRule(rule, _header.rules);
+        return;
+    }
+    throw std::runtime_error("No RLE header line");
+}
+
+void RleReader::readRuns(const std::function<void(int64_t x, int64_t y, int64_t length)>& live) {
+    char buffer[1 << 16];
+    int64_t x = 0;
+    int64_t y = 0;
+    int64_t count = 0;
+    bool in_comment = false;
+    while (_in) {
+        _in.read(buffer, sizeof(buffer));
+        std::streamsize read = _in.gcount();
+        for (std::streamsize i = 0; i < read; i++) {
+            char c = buffer[i];
+            if (in_comment) {
+                in_comment = c != '\n';
+                continue;
+            }
+            if (c >= '0' && c <= '9') {
+                count = count * 10 + (c - '0');
+                continue;
+            }
+            int64_t run = count > 0 ? count : 1;
+            count = 0;
+            if (c == 'b' || c == '.') {
+                x += run;
+            } else if (c == '$') {
+                x = 0;
+                y += run;
+            } else if (c == '!') {
+                return;
+            } else if (c == '#') {
+                in_comment = true;
+            } else if (std::isalpha(static_cast<unsigned char>(c))) {
+                live(x, y, run);
+                x += run;
+            } else if (!std::isspace(static_cast<unsigned char>(c))) {
+                throw std::runtime_error(std::string("Unexpected '") + c + "' in RLE data");
+            }
+        }
+    }
+}
+
+void RleReader::readInto(BitGrid& grid, int64_t offset_x, int64_t offset_y) {
+    readRuns([&](int64_t x, int64_t y, int64_t length) {
+        int64_t row = y + offset_y;
+        int64_t begin = std::max<int64_t>(x + offset_x, 0);
+        int64_t end = std::min<int64_t>(x + offset_x + length, grid.width());
+        if (row >= 0 && row < grid.height() && begin < end) {
+            fillRun(grid.row(static_cast<int>(row)), begin, end);
+        }
+    });
+}
+
+void writeRle(std::ostream& out, const BitGrid& grid, const int rules[RULE_COUNT]) {
+    out << "x = " << grid.width() << ", y = " << grid.height() << ", rule = " << formatRule(rules) << '\n';
+    std::string line;
+    auto item = [&](int64_t count, char tag) {
+        std::string text = count > 1 ? std::to_string(count) + tag : std::string(1, tag);
+        if (line.size() + text.size() > 70) {
+            out << line << '\n';
+            line.clear();
+        }
+        line += text;
+    };
+    // Row ends owed since the last live cell, trailing dead cells and empty rows are never written out
+    int64_t rows_pending = 0;
+    for (int y = 0; y < grid.height(); y++) {
+        const uint64_t* row = grid.row(y);
+        int x = nextCell(row, 0, grid.width(), true);
+        if (x < grid.width() && rows_pending > 0) {
+            item(rows_pending, '$');
+            rows_pending = 0;
+        }
+        int dead_from = 0;
+        while (x < grid.width()) {
+            int end = nextCell(row, x, grid.width(), false);
+            if (x > dead_from) {
+                item(x - dead_from, 'b');
+            }
+            item(end - x, 'o');
+            dead_from = end;
+            x = nextCell(row, end, grid.width(), true);
+        }
+        rows_pending++;
+    }
+    item(1, '!');
+    out << line << '\n';
+}
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gol/snapshot.hpp"
+
+// Files are the host's memory layout, mapped and used as they are
+static_assert(std::endian::native == std::endian::little);
+
+namespace {
+
+constexpr char MAGIC[8] = {'G', 'O', 'L', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t VERSION = 1;
+// Tiles start on a cache line
+constexpr size_t TILES_ALIGNMENT = 64;
+
+constexpr uint32_t CODEC_RAW = 0;
+// Words of the form zeros | literals << 32, each followed by its `literals` words, after `zeros` zero words
+constexpr uint32_t CODEC_ZERO_RUNS = 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t tile_rows;
+    int32_t width;
+    int32_t height;
+    uint32_t birth;
+    uint32_t keep;
+    uint64_t generation;
+    uint64_t seed;
+    uint32_t tile_count;
+    uint32_t reserved;
+};
+static_assert(sizeof(Header) == 56 && sizeof(SnapshotFile::Tile) == 32);
+
+// Four interleaved multiply-xorshift lanes, so the multiplications do not wait on each other
+uint64_t checksum(const uint64_t* words, size_t count) {
+    constexpr uint64_t K = 0x9E3779B97F4A7C15ull;
+    uint64_t lanes[4] = {K, K * 3, K * 5, K * 7};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t h = (lanes[lane] ^ words[i + lane]) * K;
+            lanes[lane] = h ^ (h >> 29);
+        }
+    }
+    for (; i < count; i++) {
+        uint64_t h = (lanes[0] ^ words[i]) * K;
+        lanes[0] = h ^ (h >> 29);
+    }
+    uint64_t h = count;
+    for (uint64_t lane : lanes) {
+        h = (h ^ lane) * K;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+void encodeZeroRuns(const std::vector<uint64_t>& words, std::vector<uint64_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < words.size()) {
+        size_t zeros = 0;
+        while (i + zeros < words.size() && words[i + zeros] == 0 && zeros < UINT32_MAX) {
+            zeros++;
+        }
+        size_t literals = 0;
+        while (i + zeros + literals < words.size() && words[i + zeros + literals] != 0 && literals < UINT32_MAX) {
+            literals++;
+        }
+        out.push_back(zeros | uint64_t(literals) << 32);
+        out.insert(out.end(), words.begin() + i + zeros, words.begin() + i + zeros + literals);
+        i += zeros + literals;
+    }
+}
+
+void decodeZeroRuns(const uint64_t* in, size_t in_words, uint64_t* out, size_t out_words) {
+    size_t written = 0;
+    size_t i = 0;
+    while (i < in_words) {
+        uint64_t zeros = in[i] & UINT32_MAX;
+        uint64_t literals = in[i] >> 32;
+        i++;
+        if (zeros + literals > out_words - written || literals > in_words - i) {
+            throw std::runtime_error("Corrupt snapshot tile");
+        }
+        std::fill_n(out + written, zeros, 0);
+        std::copy_n(in + i, literals, out + written + zeros);
+        written += zeros + literals;
+        i += literals;
+    }
+    if (written != out_words) {
+        throw std::runtime_error("Corrupt snapshot tile");
+    }
+}
+
+} // namespace
+
+void writeSnapshot(
+    const std::string& path, const SnapshotInfo& info, const uint64_t* rows, size_t stride, bool compress
+) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Could not create " + path);
+    }
+    RuleMasks masks = compileRules(info.rules);
+    int words = (info.width + 63) / 64;
+    int tile_count = (info.height + SNAPSHOT_TILE_ROWS - 1) / SNAPSHOT_TILE_ROWS;
+    int last_bits = info.width - (words - 1) * 64;
+    uint64_t last_mask = last_bits == 64 ? ~uint64_t(0) : (uint64_t(1) << last_bits) - 1;
+
+    Header header = {};
+    std::copy(MAGIC, MAGIC + 8, header.magic);
+    header.version = VERSION;
+    header.tile_rows = SNAPSHOT_TILE_ROWS;
+    header.width = info.width;
+    header.height = info.height;
+    header.birth = masks.birth;
+    header.keep = masks.keep;
+    header.generation = info.generation;
+    header.seed = info.seed;
+    header.tile_count = tile_count;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // The table is rewritten once the tiles' sizes are known
+    using TileEntry = SnapshotFile::Tile;
+    std::vector<TileEntry> table(tile_count);
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(TileEntry));
+    size_t offset = sizeof(Header) + table.size() * sizeof(TileEntry);
+    size_t padding = (TILES_ALIGNMENT - offset % TILES_ALIGNMENT) % TILES_ALIGNMENT;
+    out.write(std::string(padding, '\0').data(), padding);
+    offset += padding;
+
+    std::vector<uint64_t> tile;
+    std::vector<uint64_t> encoded;
+    for (int t = 0; t < tile_count; t++) {
+        int row_begin = t * SNAPSHOT_TILE_ROWS;
+        int row_end = std::min(info.height, row_begin + SNAPSHOT_TILE_ROWS);
+        tile.resize(size_t(row_end - row_begin) * words);
+        for (int y = row_begin; y < row_end; y++) {
+            uint64_t* row = tile.data() + size_t(y - row_begin) * words;
+            std::copy_n(rows + y * stride, words, row);
+            row[words - 1] &= last_mask;
+        }
+        TileEntry& entry = table[t];
+        entry.offset = offset;
+        entry.checksum = checksum(tile.data(), tile.size());
+        const std::vector<uint64_t>* stored = &tile;
+        if (compress) {
+            encodeZeroRuns(tile, encoded);
+            if (encoded.size() < tile.size()) {
+                entry.codec = CODEC_ZERO_RUNS;
+                stored = &encoded;
+            }
+        }
+        entry.size = stored->size() * sizeof(uint64_t);
+        out.write(reinterpret_cast<const char*>(stored->data()), entry.size);
+        offset += entry.size;
+    }
+    out.seekp(sizeof(Header));
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(TileEntry));
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+}
+
+SnapshotFile::SnapshotFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(path + " not found");
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || size_t(status.st_size) < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error(path + " is not a snapshot");
+    }
+    _size = status.st_size;
+    void* mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive on its own
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + path);
+    }
+    _data = static_cast<const unsigned char*>(mapping);
+
+    // Anything thrown past this point leaves the destructor uncalled
+    auto fail = [&](const std::string& reason) {
+        munmap(mapping, _size);
+        throw std::runtime_error(path + ": " + reason);
+    };
+    Header header;
+    std::memcpy(&header, _data, sizeof(header));
+    if (!std::equal(MAGIC, MAGIC + 8, header.magic)) {
+        fail("not a snapshot");
+    }
+    if (header.version != VERSION) {
+        fail("unsupported snapshot version " + std::to_string(header.version));
+    }
+    // Tiles are indexed and sized with ints, a larger tile_rows would wrap to a negative count
+    if (header.width <= 0 || header.height <= 0 || header.tile_rows == 0 || header.tile_rows > INT_MAX ||
+        header.tile_count != (uint64_t(header.height) + header.tile_rows - 1) / header.tile_rows) {
+        fail("inconsistent snapshot header");
+    }
+    _info.width = header.width;
+    _info.height = header.height;
+    for (int i = 0; i < RULE_COUNT; i++) {
+        _info.rules[i] = header.birth >> i & 1 ? RULE_BIRTH : header.keep >> i & 1 ? RULE_KEEP : RULE_DIE;
+    }
+    _info.generation = header.generation;
+    _info.seed = header.seed;
+    _tile_rows = static_cast<int>(header.tile_rows);
+
+    if (_size < sizeof(Header) + uint64_t(header.tile_count) * sizeof(Tile)) {
+        fail("truncated tile table");
+    }
+    _tiles.resize(header.tile_count);
+    std::memcpy(_tiles.data(), _data + sizeof(Header), _tiles.size() * sizeof(Tile));
+    bool contiguous = true;
+    for (int t = 0; t < tileCount(); t++) {
+        const Tile& tile = _tiles[t];
+        uint64_t raw_size = uint64_t(tileRows(t)) * words() * sizeof(uint64_t);
+        if (tile.offset % sizeof(uint64_t) != 0 || tile.size % sizeof(uint64_t) != 0 || tile.offset > _size ||
+            tile.size > _size - tile.offset || tile.codec > CODEC_ZERO_RUNS ||
+            (tile.codec == CODEC_RAW && tile.size != raw_size)) {
+            fail("corrupt tile table");
+        }
+        contiguous = contiguous && tile.codec == CODEC_RAW &&
+                     tile.offset == _tiles[0].offset + uint64_t(t) * _tile_rows * words() * sizeof(uint64_t);
+    }
+    if (contiguous) {
+        _rows = reinterpret_cast<const uint64_t*>(_data + _tiles[0].offset);
+    }
+}
+
+SnapshotFile::~SnapshotFile() {
+    munmap(const_cast<unsigned char*>(_data), _size);
+}
+
+int SnapshotFile::tileRows(int tile) const {
+    return std::min(_tile_rows, _info.height - tile * _tile_rows);
+}
+
+void SnapshotFile::readTile(int tile, uint64_t* out) const {
+    const Tile& entry = _tiles[tile];
+    const uint64_t* stored = reinterpret_cast<const uint64_t*>(_data + entry.offset);
+    size_t words = size_t(tileRows(tile)) * this->words();
+    if (entry.codec == CODEC_RAW) {
+        std::copy_n(stored, words, out);
+    } else {
+        decodeZeroRuns(stored, entry.size / sizeof(uint64_t), out, words);
+    }
+    if (checksum(out, words) != entry.checksum) {
+        throw std::runtime_error("Snapshot tile " + std::to_string(tile) + " does not match its checksum");
+    }
+}
+
+void SnapshotFile::readInto(BitGrid& grid) const {
+    if (grid.width() != _info.width || grid.height() != _info.height) {
+        throw std::invalid_argument("Grid and snapshot sizes differ");
+    }
+    std::vector<uint64_t> tile;
+    for (int t = 0; t < tileCount(); t++) {
+        tile.resize(size_t(tileRows(t)) * words());
+        readTile(t, tile.data());
+        for (int y = 0; y < tileRows(t); y++) {
+            std::copy_n(tile.data() + size_t(y) * words(), words(), grid.row(t * _tile_rows + y));
+        }
+    }
+}
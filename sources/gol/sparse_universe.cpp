@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+#include "gol/kernel.hpp"
+#include "gol/sparse_universe.hpp"
+
+SparseUniverse::ChunkMap::ChunkMap() {
+    rehash(64);
+}
+
+size_t SparseUniverse::ChunkMap::slotOf(uint64_t key) const {
+    key *= 0x9E3779B97F4A7C15ull;
+    return (key ^ key >> 32) & (_keys.size() - 1);
+}
+
+void SparseUniverse::ChunkMap::rehash(size_t capacity) {
+    std::vector<uint64_t> keys(capacity);
+    std::vector<uint32_t> values(capacity, NONE);
+    std::swap(keys, _keys);
+    std::swap(values, _values);
+    _size = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (values[i] != NONE) {
+            insert(keys[i], values[i]);
+        }
+    }
+}
+
+uint32_t SparseUniverse::ChunkMap::find(uint64_t key) const {
+    for (size_t slot = slotOf(key);; slot = (slot + 1) & (_keys.size() - 1)) {
+        if (_values[slot] == NONE) {
+            return NONE;
+        }
+        if (_keys[slot] == key) {
+            return _values[slot];
+        }
+    }
+}
+
+uint32_t& SparseUniverse::ChunkMap::insert(uint64_t key, uint32_t value) {
+    if ((_size + 1) * 2 > _keys.size()) {
+        rehash(_keys.size() * 2);
+    }
+    size_t slot = slotOf(key);
+    for (; _values[slot] != NONE; slot = (slot + 1) & (_keys.size() - 1)) {
+        if (_keys[slot] == key) {
+            return _values[slot];
+        }
+    }
+    _keys[slot] = key;
+    _values[slot] = value;
+    _size++;
+    _peak = std::max(_peak, _size);
+    return _values[slot];
+}
+
+void SparseUniverse::ChunkMap::clear() {
+    // Shrink back when the map was much larger than it needed to be lately
+    size_t capacity = _keys.size();
+    while (capacity > 64 && _peak * 8 < capacity) {
+        capacity /= 2;
+    }
+    _peak = 0;
+    _size = 0;
+    if (capacity != _keys.size()) {
+        rehash(capacity);
+    } else {
+        std::fill(_values.begin(), _values.end(), NONE);
+    }
+}
+
+SparseUniverse::SparseUniverse(const int rules[RULE_COUNT]) {
+    setRules(rules);
+}
+
+void SparseUniverse::setRules(const int rules[RULE_COUNT]) {
+    if (rules[0] == RULE_BIRTH) {
+        throw std::invalid_argument("An unbounded universe cannot run rules giving birth with no neighbors");
+    }
+    _rules = compileRules(rules);
+}
+
+size_t SparseUniverse::memoryUsage() const {
+    size_t maps = (_chunks.capacity() + _next_chunks.capacity() + _candidates.capacity()) *
+                  (sizeof(uint64_t) + sizeof(uint32_t));
+    return _pool.capacity() * sizeof(Chunk) + _free.capacity() * sizeof(uint32_t) + maps;
+}
+
+uint32_t SparseUniverse::allocate() {
+    if (!_free.empty()) {
+        uint32_t chunk = _free.back();
+        _free.pop_back();
+        return chunk;
+    }
+    _pool.emplace_back();
+    return static_cast<uint32_t>(_pool.size() - 1);
+}
+
+void SparseUniverse::release(uint32_t chunk) {
+    _free.push_back(chunk);
+}
+
+const SparseUniverse::Chunk* SparseUniverse::chunkAt(int64_t chunk_x, int64_t chunk_y) const {
+    if (!inRange(chunk_x, chunk_y)) {
+        return nullptr;
+    }
+    uint32_t chunk = _chunks.find(keyOf(chunk_x, chunk_y));
+    return chunk == NONE ? nullptr : &_pool[chunk];
+}
+
+bool SparseUniverse::getCell(int64_t x, int64_t y) const {
+    const Chunk* chunk = chunkAt(x >> 6, y >> 6);
+    return chunk && chunk->rows[y & 63] >> (x & 63) & 1;
+}
+
+void SparseUniverse::setCell(int64_t x, int64_t y, bool alive) {
+    if (!inRange(x >> 6, y >> 6)) {
+        throw std::out_of_range("Cell outside of the sparse universe");
+    }
+    uint64_t key = keyOf(x >> 6, y >> 6);
+    uint32_t chunk = _chunks.find(key);
+    if (chunk == NONE) {
+        if (!alive) {
+            return;
+        }
+        chunk = allocate();
+        std::fill(std::begin(_pool[chunk].rows), std::end(_pool[chunk].rows), 0);
+        _chunks.insert(key, chunk);
+    }
+    uint64_t bit = uint64_t(1) << (x & 63);
+    if (alive) {
+        _pool[chunk].rows[y & 63] |= bit;
+    } else {
+        _pool[chunk].rows[y & 63] &= ~bit;
+    }
+}
+
+void SparseUniverse::clear() {
+    _chunks.clear();
+    _pool.clear();
+    _pool.shrink_to_fit();
+    _free.clear();
+    _free.shrink_to_fit();
+    _generation = 0;
+}
+
+uint64_t SparseUniverse::population() const {
+    uint64_t count = 0;
+    _chunks.forEach([&](uint64_t, uint32_t chunk) {
+        for (uint64_t row : _pool[chunk].rows) {
+            count += std::popcount(row);
+        }
+    });
+    return count;
+}
+
+bool SparseUniverse::stepChunk(uint64_t key, Chunk& out) const {
+    int64_t chunk_x = chunkX(key);
+    int64_t chunk_y = chunkY(key);
+    const Chunk* around[3][3];
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            around[dy + 1][dx + 1] = chunkAt(chunk_x + dx, chunk_y + dy);
+        }
+    }
+    auto word = [&](int column, int y) -> uint64_t {
+        int row = y < 0 ? 0 : y >= CHUNK_SIZE ? 2 : 1;
+        const Chunk* chunk = around[row][column];
+        return chunk ? chunk->rows[(y + CHUNK_SIZE) % CHUNK_SIZE] : 0;
+    };
+
+    // Rows -1 to 64 of the chunk with the chunks on each side as guard words, the layout stepRow expects
+    uint64_t rows[CHUNK_SIZE + 2][3];
+    for (int y = -1; y <= CHUNK_SIZE; y++) {
+        for (int column = 0; column < 3; column++) {
+            rows[y + 1][column] = word(column, y);
+        }
+    }
+    uint64_t any = 0;
+    for (int y = 0; y < CHUNK_SIZE; y++) {
+        stepRow(&rows[y][1], &rows[y + 1][1], &rows[y + 2][1], &out.rows[y], 1, _rules);
+        any |= out.rows[y];
+    }
+    return any != 0;
+}
+
+void SparseUniverse::step(int generations) {
+    for (int g = 0; g < generations; g++) {
+        // Chunks that can hold live cells next generation: the live ones, and their neighbors across any
+        // border with live cells on it
+        _candidates.clear();
+        _chunks.forEach([&](uint64_t key, uint32_t chunk) {
+            const Chunk& c = _pool[chunk];
+            uint64_t left = 0;
+            uint64_t right = 0;
+            uint64_t any = 0;
+            for (uint64_t row : c.rows) {
+                left |= row & 1;
+                right |= row >> 63;
+                any |= row;
+            }
+            if (!any) {
+                return;
+            }
+            bool north = c.rows[0] != 0;
+            bool south = c.rows[CHUNK_SIZE - 1] != 0;
+            int64_t x = chunkX(key);
+            int64_t y = chunkY(key);
+            // Nothing grows past the edge of the universe
+            auto add = [&](int64_t chunk_x, int64_t chunk_y) {
+                if (inRange(chunk_x, chunk_y)) {
+                    _candidates.insert(keyOf(chunk_x, chunk_y), 0);
+                }
+            };
+            _candidates.insert(key, 0);
+            if (north) {
+                add(x, y - 1);
+            }
+            if (south) {
+                add(x, y + 1);
+            }
+            if (left) {
+                add(x - 1, y);
+                if (c.rows[0] & 1) {
+                    add(x - 1, y - 1);
+                }
+                if (c.rows[CHUNK_SIZE - 1] & 1) {
+                    add(x - 1, y + 1);
+                }
+            }
+            if (right) {
+                add(x + 1, y);
+                if (c.rows[0] >> 63) {
+                    add(x + 1, y - 1);
+                }
+                if (c.rows[CHUNK_SIZE - 1] >> 63) {
+                    add(x + 1, y + 1);
+                }
+            }
+        });
+
+        _next_chunks.clear();
+        Chunk scratch;
+        _candidates.forEach([&](uint64_t key, uint32_t) {
+            if (stepChunk(key, scratch)) {
+                uint32_t chunk = allocate();
+                _pool[chunk] = scratch;
+                _next_chunks.insert(key, chunk);
+            }
+        });
+        _chunks.forEach([&](uint64_t, uint32_t chunk) { release(chunk); });
+        std::swap(_chunks, _next_chunks);
+        _generation++;
+    }
+}
+
+void SparseUniverse::loadGrid(const BitGrid& grid, int64_t x, int64_t y) {
+    if (x < MIN_COORDINATE || y < MIN_COORDINATE || x > MAX_COORDINATE - grid.width() + 1 ||
+        y > MAX_COORDINATE - grid.height() + 1) {
+        throw std::out_of_range("Grid outside of the sparse universe");
+    }
+    clear();
+    for (int gy = 0; gy < grid.height(); gy++) {
+        for (int gx = 0; gx < grid.width(); gx++) {
+            if (grid.get(gx, gy)) {
+                setCell(x + gx, y + gy, true);
+            }
+        }
+    }
+}
+
+void SparseUniverse::storeGrid(BitGrid& grid, int64_t x, int64_t y) const {
+    grid.clear();
+    _chunks.forEach([&](uint64_t key, uint32_t chunk) {
+        int64_t base_x = chunkX(key) * CHUNK_SIZE - x;
+        int64_t base_y = chunkY(key) * CHUNK_SIZE - y;
+        for (int cy = 0; cy < CHUNK_SIZE; cy++) {
+            uint64_t row = _pool[chunk].rows[cy];
+            int64_t gy = base_y + cy;
+            if (!row || gy < 0 || gy >= grid.height()) {
+                continue;
+            }
+            for (; row; row &= row - 1) {
+                int64_t gx = base_x + std::countr_zero(row);
+                if (gx >= 0 && gx < grid.width()) {
+                    grid.set(static_cast<int>(gx), static_cast<int>(gy), true);
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+
+#include "gol/thread_pool.hpp"
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threads; i++) {
+        _queues.push_back(std::make_unique<Queue>());
+    }
+    // Queue 0 belongs to the thread calling parallelFor()
+    for (int i = 1; i < threads; i++) {
+        _workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+    if (_workers.empty() || count == 1) {
+        for (int i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    // Contiguous runs per queue keep neighboring tiles on the same core until stealing kicks in
+    int queues = size();
+    for (int q = 0; q < queues; q++) {
+        int begin = static_cast<int>(static_cast<int64_t>(count) * q / queues);
+        int end = static_cast<int>(static_cast<int64_t>(count) * (q + 1) / queues);
+        std::lock_guard lock(_queues[q]->mutex);
+        for (int i = begin; i < end; i++) {
+            _queues[q]->items.push_back(i);
+        }
+    }
+    {
+        std::lock_guard lock(_mutex);
+        _task = &task;
+        _busy_workers = static_cast<int>(_workers.size());
+        _round++;
+    }
+    _wake.notify_all();
+
+    drain(0);
+
+    // Waiting for the workers to be idle, not only for the tasks to be done, so none of them can still be
+    // looking for work when the next round fills the queues
+    std::unique_lock lock(_mutex);
+    _done.wait(lock, [this] { return _busy_workers == 0; });
+    _task = nullptr;
+}
+
+void ThreadPool::workerLoop(int index) {
+    uint64_t seen_round = 0;
+    while (true) {
+        {
+            std::unique_lock lock(_mutex);
+            _wake.wait(lock, [&] { return _stopping || _round != seen_round; });
+            if (_stopping) {
+                return;
+            }
+            seen_round = _round;
+        }
+        drain(index);
+        {
+            std::lock_guard lock(_mutex);
+            _busy_workers--;
+        }
+        _done.notify_all();
+    }
+}
+
+void ThreadPool::drain(int index) {
+    int item;
+    while (pop(index, item)) {
+        (*_task)(item);
+    }
+}
+
+bool ThreadPool::pop(int index, int& item) {
+    {
+        Queue& own = *_queues[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.items.empty()) {
+            item = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+    int queues = size();
+    for (int offset = 1; offset < queues; offset++) {
+        Queue& victim = *_queues[(index + offset) % queues];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.items.empty()) {
+            item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "gol/cpu_engine.hpp"
+#include "gol/hashlife.hpp"
+#include "gol/image_stream.hpp"
+#include "gol/kernel.hpp"
+#include "gol/lut_engine.hpp"
+#include "gol/macrocell.hpp"
+#include "gol/rle.hpp"
+#include "gol/rules.hpp"
+#include "gol/snapshot.hpp"
+#include "gol/sparse_universe.hpp"
+#include "headless.hpp"
+#include "loader.hpp"
+#include "rng.hpp"
+
+namespace {
+
+// Quadtree patterns step on HashLife, an unbounded universe, as most of them would not fit in memory as a torus
+void stepMacrocell(
+    const std::string& in, const std::string& out, int rules[RULE_COUNT], bool rule_given, long long generations
+) {
+    std::ifstream file(in, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(std::format("{} not found", in));
+    }
+    HashLife life(rules);
+    MacrocellHeader header = readMacrocell(file, life);
+    // An explicit --rule wins over the file's
+    if (header.has_rule && !rule_given) {
+        std::copy(header.rules, header.rules + RULE_COUNT, rules);
+        life.setRules(rules);
+    }
+
+    std::cout << std::format(
+                     "{}: {} nodes of up to 2^{} cells a side, {}, {} generations, HashLife", in, life.nodeCount(),
+                     life.rootLevel(), formatRule(rules), generations
+                 )
+              << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    life.step(generations);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::format(
+                     "{:.3f} s, {:.1f} generations/s, {} nodes, population {}", seconds, generations / seconds,
+                     life.nodeCount(), life.population()
+                 )
+              << std::endl;
+
+    if (out.ends_with(".mc")) {
+        std::ofstream file(out, std::ios::binary);
+        writeMacrocell(file, life, rules);
+        if (!file) {
+            throw std::runtime_error(std::format("Could not write {}", out));
+        }
+    } else if (out.ends_with(".rle")) {
+        // The live cells' bounding box as a torus
+        int64_t left = 0, top = 0, right = 1, bottom = 1;
+        life.bounds(left, top, right, bottom);
+        if (right - left > INT_MAX || bottom - top > INT_MAX) {
+            throw std::runtime_error(std::format("{}x{} is too large for .rle", right - left, bottom - top));
+        }
+        BitGrid grid(int(right - left), int(bottom - top));
+        life.storeGrid(grid, left, top);
+        std::ofstream file(out, std::ios::binary);
+        writeRle(file, grid, rules);
+        if (!file) {
+            throw std::runtime_error(std::format("Could not write {}", out));
+        }
+    } else if (!out.empty()) {
+        throw std::runtime_error("Macrocell runs are written as .mc or .rle");
+    }
+}
+
+} // namespace
+
+int runHeadless(int argc, const char* argv[]) {
+    std::string in;
+    std::string out;
+    std::string rule = "B3/S23";
+    bool rule_given = false;
+    long long generations = 1;
+    int soup_width = 0;
+    int soup_height = 0;
+    float density = .5f;
+    unsigned long long seed = 0;
+    bool compress = false;
+    std::string engine_name = "cpu";
+    // Generation of the snapshot the run continues
+    uint64_t first_generation = 0;
+    CpuEngineOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            continue;
+        }
+        if (arg == "--compress") {
+            compress = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value after %s\n", argv[i]);
+            return -1;
+        }
+        const char* value = argv[++i];
+        bool valid = true;
+        if (arg == "--in") {
+            in = value;
+        } else if (arg == "--out") {
+            out = value;
+        } else if (arg == "--rule") {
+            rule = value;
+            rule_given = true;
+        } else if (arg == "--soup") {
+            valid = sscanf(value, "%dx%d", &soup_width, &soup_height) == 2 && soup_width > 0 && soup_height > 0;
+        } else if (arg == "--density") {
+            valid = sscanf(value, "%f", &density) == 1;
+        } else if (arg == "--seed") {
+            valid = sscanf(value, "%llu", &seed) == 1;
+        } else if (arg == "--gens") {
+            valid = sscanf(value, "%lld", &generations) == 1 && generations >= 0;
+        } else if (arg == "--threads") {
+            valid = sscanf(value, "%d", &options.threads) == 1 && options.threads >= 0;
+        } else if (arg == "--engine") {
+            engine_name = value;
+            valid = engine_name == "cpu" || engine_name == "lut" || engine_name == "sparse";
+        } else if (arg == "--tile-size") {
+            valid = sscanf(value, "%d", &options.tile_size) == 1 && options.tile_size > 0;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Unexpected %s %s\n", argv[i - 1], value);
+            return -1;
+        }
+    }
+    if (in.empty() == (soup_width == 0)) {
+        fprintf(stderr, "Expected either --in FILE or --soup WIDTHxHEIGHT\n");
+        return -1;
+    }
+
+    try {
+        int rules[RULE_COUNT];
+        parseRule(rule, rules);
+        std::unique_ptr<CpuEngine> engine;
+        if (in.ends_with(".mc")) {
+            stepMacrocell(in, out, rules, rule_given, generations);
+            return 0;
+        } else if (in.ends_with(".snap")) {
+            SnapshotFile snapshot(in);
+            const SnapshotInfo& info = snapshot.info();
+            engine = std::make_unique<CpuEngine>(info.width, info.height, options);
+            snapshot.readInto(engine->grid());
+            if (!rule_given) {
+                std::copy(info.rules, info.rules + RULE_COUNT, rules);
+            }
+            seed = info.seed;
+            first_generation = info.generation;
+        } else if (in.ends_with(".rle")) {
+            std::ifstream file(in, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error(std::format("{} not found", in));
+            }
+            RleReader reader(file);
+            const RleHeader& header = reader.header();
+            if (header.width < 1 || header.height < 1 || header.width > INT_MAX || header.height > INT_MAX) {
+                throw std::runtime_error(
+                    std::format("{}x{} is not a usable universe size", header.width, header.height)
+                );
+            }
+            engine = std::make_unique<CpuEngine>(int(header.width), int(header.height), options);
+            reader.readInto(engine->grid(), 0, 0);
+            // An explicit --rule wins over the file's
+            if (header.has_rule && !rule_given) {
+                std::copy(header.rules, header.rules + RULE_COUNT, rules);
+            }
+        } else if (!in.empty()) {
+            // Bands are copied in while the next ones decode, the image is never whole in memory. What the streams
+            // cannot read, such as interlaced PNG or RLE BMP, is decoded whole instead.
+            std::optional<ImageStream> stream;
+            if (ImageStream::supports(in)) {
+                try {
+                    stream.emplace(in);
+                } catch (const std::exception&) {
+                }
+            }
+            if (stream) {
+                engine = std::make_unique<CpuEngine>(stream->width(), stream->height(), options);
+                ImageBandReader reader(std::move(*stream), engine->width(), engine->height());
+                ImageBand band;
+                while (reader.next(band, true)) {
+                    for (int y = 0; y < band.rows; y++) {
+                        std::copy_n(
+                            band.bits.data() + size_t(y) * band.words, band.words, engine->grid().row(band.y + y)
+                        );
+                    }
+                }
+            } else {
+                ImageSize size = imageSize(in);
+                engine = std::make_unique<CpuEngine>(size.width, size.height, options);
+                loadImage(in, engine->grid());
+            }
+        } else {
+            engine = std::make_unique<CpuEngine>(soup_width, soup_height, options);
+            engine->loadSoup(seed, RandomNumberGenerator::soupThreshold(density));
+            in = std::format("soup {:.3f} seed {}", density, seed);
+        }
+        // Every input is read into the torus engine's grid, the other engines take its cells from there and give
+        // them back for the output
+        engine->setRules(rules);
+        int width = engine->width();
+        int height = engine->height();
+        std::unique_ptr<SparseUniverse> sparse;
+        std::unique_ptr<LutEngine> lut;
+        std::string description;
+        if (engine_name == "lut") {
+            lut = std::make_unique<LutEngine>(width, height, options.threads);
+            lut->setRules(rules);
+            lut->grid() = engine->grid();
+            description = std::format("{} threads, 2x2 block table", lut->threads());
+        } else if (engine_name == "sparse") {
+            sparse = std::make_unique<SparseUniverse>(rules);
+            sparse->loadGrid(engine->grid());
+            description = "sparse unbounded universe";
+        } else {
+            description = std::format(
+                "{} threads, {}x{} tiles, kernel {}", engine->threads(), engine->tileWidth(), engine->tileSize(),
+                kernelIsaName(kernelIsa())
+            );
+        }
+
+        std::cout << std::format(
+                         "{}: {}x{}, {}, {} generations, {}", in, width, height, formatRule(rules), generations,
+                         description
+                     )
+                  << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        for (long long left = generations; left > 0; left -= INT_MAX) {
+            int batch = int(std::min<long long>(left, INT_MAX));
+            if (sparse) {
+                sparse->step(batch);
+            } else if (lut) {
+                lut->step(batch);
+            } else {
+                engine->step(batch);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t population = sparse ? sparse->population() : lut ? lut->population() : engine->population();
+        std::cout << std::format(
+                         "{:.3f} s, {:.1f} generations/s, {:.3f} Gcells/s, population {}", seconds,
+                         generations / seconds, double(width) * height * generations / seconds / 1e9, population
+                     )
+                  << std::endl;
+        if (lut) {
+            engine->grid() = lut->grid();
+        }
+        if (sparse) {
+            // The unbounded pattern is written as seen through the input's window
+            sparse->storeGrid(engine->grid());
+            std::cout << std::format(
+                             "{} chunks, {} live cells in the written window", sparse->chunkCount(),
+                             engine->population()
+                         )
+                      << std::endl;
+        }
+
+        if (out.ends_with(".snap")) {
+            SnapshotInfo info;
+            info.width = width;
+            info.height = height;
+            std::copy(rules, rules + RULE_COUNT, info.rules);
+            info.generation = first_generation + generations;
+            info.seed = seed;
+            writeSnapshot(out, info, engine->grid().row(0), engine->grid().stride(), compress);
+        } else if (out.ends_with(".mc")) {
+            HashLife life = macrocellStore();
+            life.loadGrid(engine->grid(), -width / 2, -height / 2);
+            std::ofstream file(out, std::ios::binary);
+            writeMacrocell(file, life, rules);
+            if (!file) {
+                throw std::runtime_error(std::format("Could not write {}", out));
+            }
+        } else if (out.ends_with(".rle")) {
+            std::ofstream file(out, std::ios::binary);
+            writeRle(file, engine->grid(), rules);
+            if (!file) {
+                throw std::runtime_error(std::format("Could not write {}", out));
+            }
+        } else if (!out.empty()) {
+            saveImage(out, width, height, engine->storeCells());
+        }
+    } catch (const std::exception& error) {
+        fprintf(stderr, "%s\n", error.what());
+        return -1;
+    }
+    return 0;
+}
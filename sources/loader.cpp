@@ -1,20 +1,37 @@
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <glad/glad.h>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
 
+#include "gol/image_stream.hpp"
+#include "gol/kernel.hpp"
 #include "loader.hpp"
 
-GLuint loadShader(const std::filesystem::path& file, const GLuint& type) {
+namespace {
+std::string readShaderSource(const std::filesystem::path& file, const std::string& defines) {
     std::ifstream shader_file(file);
     if (!shader_file) {
         throw std::runtime_error(std::format("{} not found", file.string()));
     }
     std::string shader_source((std::istreambuf_iterator<char>(shader_file)), (std::istreambuf_iterator<char>()));
+    if (!defines.empty()) {
+        // #version has to stay the first line
+        auto version_end = shader_source.find('\n', shader_source.find("#version")) + 1;
+        shader_source.insert(version_end, defines);
+    }
+    return shader_source;
+}
+
+GLuint compileShader(const std::string& shader_source, GLuint type) {
     auto shader_source_c = shader_source.c_str();
     GLuint shader = glCreateShader(type);
     glShaderSource(shader, 1, &shader_source_c, NULL);
@@ -29,6 +46,19 @@ GLuint loadShader(const std::filesystem::path& file, const GLuint& type) {
     return shader;
 }
 
+// FNV-1a, stable across runs and compilers unlike std::hash
+uint64_t hashString(const std::string& string, uint64_t hash = 0xcbf29ce484222325) {
+    for (unsigned char c : string) {
+        hash = (hash ^ c) * 0x100000001b3;
+    }
+    return hash;
+}
+} // namespace
+
+GLuint loadShader(const std::filesystem::path& file, const GLuint& type, const std::string& defines) {
+    return compileShader(readShaderSource(file, defines), type);
+}
+
 GLuint loadShaderProgram(const std::filesystem::path& vertex_file, const std::filesystem::path& frament_file) {
     GLuint program = glCreateProgram();
     GLuint vertex = loadShader(vertex_file.c_str(), GL_VERTEX_SHADER);
@@ -41,29 +71,170 @@ GLuint loadShaderProgram(const std::filesystem::path& vertex_file, const std::fi
     return program;
 }
 
-GLuint loadComputeProgram(const std::filesystem::path& compute_file) {
+GLuint loadComputeProgram(const std::filesystem::path& compute_file, const std::string& defines) {
     GLuint program = glCreateProgram();
-    GLuint compute = loadShader(compute_file.c_str(), GL_COMPUTE_SHADER);
+    GLuint compute = loadShader(compute_file.c_str(), GL_COMPUTE_SHADER, defines);
     glAttachShader(program, compute);
     glDeleteShader(compute);
     glLinkProgram(program);
     return program;
 }
 
-std::vector<float> loadImage(const std::filesystem::path& file) {
+GLuint loadCachedComputeProgram(
+    const std::filesystem::path& compute_file, const std::string& defines, const std::filesystem::path& cache_dir
+) {
+    std::string source = readShaderSource(compute_file, defines);
+    // A driver update can change the binary format or the code generated for the same source
+    auto driver_string = [](GLenum name) {
+        auto string = reinterpret_cast<const char*>(glGetString(name));
+        return std::string(string ? string : "");
+    };
+    uint64_t hash = hashString(source);
+    hash = hashString(driver_string(GL_VENDOR), hash);
+    hash = hashString(driver_string(GL_RENDERER), hash);
+    hash = hashString(driver_string(GL_VERSION), hash);
+    auto cache_file = cache_dir / std::format("{:016x}.bin", hash);
+
+    GLint binary_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+    GLuint program = glCreateProgram();
+    // Any missing, truncated or rejected binary only means compiling from source as usual
+    if (binary_formats > 0) {
+        std::ifstream cached(cache_file, std::ios::binary);
+        GLenum format;
+        if (cached.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+            std::vector<char> binary((std::istreambuf_iterator<char>(cached)), (std::istreambuf_iterator<char>()));
+            glProgramBinary(program, format, binary.data(), GLsizei(binary.size()));
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (linked) {
+                return program;
+            }
+        }
+    }
+
+    GLuint compute = compileShader(source, GL_COMPUTE_SHADER);
+    glAttachShader(program, compute);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    glDetachShader(program, compute);
+    glDeleteShader(compute);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked || binary_formats == 0) {
+        return program;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    std::error_code error;
+    std::filesystem::create_directories(cache_dir, error);
+    std::ofstream cached(cache_file, std::ios::binary);
+    cached.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    cached.write(binary.data(), length);
+    return program;
+}
+
+ImageSize imageSize(const std::filesystem::path& file) {
     int w, h, d;
+    if (!stbi_info(file.c_str(), &w, &h, &d)) {
+        throw std::runtime_error(stbi_failure_reason());
+    }
+    return {w, h};
+}
+
+ImageSize loadImage(const std::filesystem::path& file, BitGrid& grid) {
+    grid.clear();
+
+    // The formats ImageStream reads are decoded a row at a time, the others and what it rejects (interlaced PNG
+    // for instance) whole by stb_image
+    std::optional<ImageStream> stream;
+    if (ImageStream::supports(file.string())) {
+        try {
+            stream.emplace(file.string());
+        } catch (const std::exception&) {
+        }
+    }
+    if (stream) {
+        int w = stream->width();
+        int h = stream->height();
+        int offset_x = (grid.width() - w) / 2;
+        int offset_y = (grid.height() - h) / 2;
+        int x_begin = std::max(0, -offset_x);
+        int x_end = std::min(w, grid.width() - offset_x);
+        int y_begin = std::max(0, -offset_y);
+        int y_end = std::min(h, grid.height() - offset_y);
+        std::vector<uint8_t> row(w);
+        for (int r = 0; r < h; r++) {
+            int y = stream->bottomUp() ? h - 1 - r : r;
+            // Rows come in file order, the ones past the visible part are not even decoded
+            if (stream->bottomUp() ? y < y_begin : y >= y_end) {
+                break;
+            }
+            stream->readRow(row.data());
+            if (y >= y_begin && y < y_end && x_begin < x_end) {
+                thresholdRowInto(row.data() + x_begin, x_end - x_begin, grid.row(y + offset_y), x_begin + offset_x);
+            }
+        }
+        return {w, h};
+    }
+
+    int w, h, d;
+    if (!stbi_info(file.c_str(), &w, &h, &d)) {
+        throw std::runtime_error(stbi_failure_reason());
+    }
+    // Gray images, with or without alpha, are decoded to their gray channel alone
+    int channels = d <= 2 ? 1 : d;
     stbi_set_flip_vertically_on_load(false);
-    auto img = stbi_load(file.c_str(), &w, &h, &d, 0);
+    auto img = stbi_load(file.c_str(), &w, &h, &d, channels == 1 ? 1 : 0);
     if (!img) {
         const char* failureReason = stbi_failure_reason();
         throw std::runtime_error(failureReason);
     }
-    std::vector<float> image(w * h);
-    for (int i = 0; i < w * h; i++) {
-        image[i] = img[i * d] > 0 ? 1.0f : 0.0f;
+    int offset_x = (grid.width() - w) / 2;
+    int offset_y = (grid.height() - h) / 2;
+    int x_begin = std::max(0, -offset_x);
+    int x_end = std::min(w, grid.width() - offset_x);
+    // The first channel of each pixel, gathered a row at a time
+    std::vector<unsigned char> row(channels == 1 ? 0 : std::max(0, x_end - x_begin));
+    for (int y = std::max(0, -offset_y); y < std::min(h, grid.height() - offset_y) && x_begin < x_end; y++) {
+        const unsigned char* pixels = img + (size_t(y) * w + x_begin) * channels;
+        if (channels > 1) {
+            for (size_t x = 0; x < row.size(); x++) {
+                row[x] = pixels[x * channels];
+            }
+            pixels = row.data();
+        }
+        thresholdRowInto(pixels, x_end - x_begin, grid.row(y + offset_y), x_begin + offset_x);
     }
     stbi_image_free(img);
-    return image;
+    return {w, h};
+}
+
+void saveImage(const std::filesystem::path& file, int width, int height, const std::vector<float>& cells) {
+    std::vector<unsigned char> pixels(cells.size());
+    for (size_t i = 0; i < cells.size(); i++) {
+        pixels[i] = cells[i] > 0.5f ? 255 : 0;
+    }
+    if (!stbi_write_png(file.c_str(), width, height, 1, pixels.data(), width)) {
+        throw std::runtime_error(std::format("Could not write {}", file.string()));
+    }
+}
+
+std::vector<float> placeImage(const CellImage& image, int width, int height) {
+    std::vector<float> cells(size_t(width) * height);
+    int offset_x = (width - image.width) / 2;
+    int offset_y = (height - image.height) / 2;
+    for (int y = std::max(0, -offset_y); y < std::min(image.height, height - offset_y); y++) {
+        int x_begin = std::max(0, -offset_x);
+        int x_end = std::min(image.width, width - offset_x);
+        auto row = image.cells.begin() + size_t(y) * image.width;
+        std::copy(row + x_begin, row + x_end, cells.begin() + size_t(y + offset_y) * width + x_begin + offset_x);
+    }
+    return cells;
 }
 
 GLuint loadTexture(const std::filesystem::path& file) {
@@ -118,6 +289,34 @@ void replaceTexture(
     glGenerateMipmap(GL_TEXTURE_2D);
 }
 
+GLuint createTextureStorage(int width, int height, GLenum internalformat) {
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, internalformat, width, height);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+void uploadTexture(GLuint texture, int width, int height, GLenum format, GLenum type, const void* data) {
+    // Rows of single channel textures are not 4 byte aligned in general
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTextureSubImage2D(texture, 0, 0, 0, width, height, format, type, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void uploadTextureRows(
+    GLuint texture, int y, int width, int height, int row_length, GLenum format, GLenum type, const void* data
+) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+    glTextureSubImage2D(texture, 0, 0, y, width, height, format, type, data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
 void reloadTexture(GLuint texture, const std::filesystem::path& file) {
     int w, h, d;
     stbi_set_flip_vertically_on_load(true);
@@ -145,6 +344,13 @@ void getTexture(GLuint texture, GLenum format, GLenum type, void* data) {
     glGetTexImage(GL_TEXTURE_2D, 0, format, type, data);
 }
 
+GLuint createBuffer(GLsizeiptr size, const void* data, GLbitfield flags) {
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, size, data, flags);
+    return buffer;
+}
+
 GLuint createFramebuffer(GLuint texture, GLuint renderbuffer) {
     GLuint framebuffer;
     glGenFramebuffers(1, &framebuffer);
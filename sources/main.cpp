@@ -1,7 +1,17 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <cstdio>
 #include <format>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <ostream>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -16,34 +26,154 @@
 #include <backends/imgui_impl_opengl3.h>
 #include <imgui.h>
 
+#include "gol/bit_grid.hpp"
+#include "gol/hashlife.hpp"
+#include "gol/image_stream.hpp"
+#include "gol/kernel.hpp"
+#include "gol/lut_engine.hpp"
+#include "gol/macrocell.hpp"
+#include "gol/rle.hpp"
+#include "gol/rules.hpp"
+#include "gol/snapshot.hpp"
+#include "headless.hpp"
 #include "loader.hpp"
+#include "profiler.hpp"
 #include "rng.hpp"
 
 constexpr int WINDOW_WIDTH = 720;
 constexpr int WINDOW_HEIGHT = 640;
 
-constexpr float FRAMERATE = 30.0f;
-constexpr float FRAME_TIME = 1.0f / FRAMERATE;
+// Generations per second until changed in the UI, independent of the display's frame rate
+constexpr int DEFAULT_GENERATION_RATE = 30;
+// Dispatches batched in one frame at most, a target the GPU cannot keep up with drops generations past that
+constexpr int MAX_DISPATCHES_PER_FRAME = 4096;
+// GPU time per frame the "max speed" mode sizes its batches after
+constexpr float MAX_SPEED_BUDGET_MS = 12.0f;
 
-constexpr int BUFFER_WIDTH = 320;
-constexpr int BUFFER_HEIGHT = 240;
+// Universe size when none is given with --size WIDTHxHEIGHT
+constexpr int DEFAULT_BUFFER_WIDTH = 320;
+constexpr int DEFAULT_BUFFER_HEIGHT = 240;
 
 constexpr int FRAMEBUFFER_WIDTH = 640;
 constexpr int FRAMEBUFFER_HEIGHT = 480;
 
-std::vector<float> getRandomImage(int width, int height, float proba = .95) {
-    static RandomNumberGenerator rng;
+// Cells per side of the shared memory kernel's workgroups and of the tiles tracked by the "skip stable tiles"
+// mode, unless given with --tile-size
+constexpr int DEFAULT_TILE_SIZE = 16;
+// Generations the shared memory kernel can compute per dispatch, tiles must stay at least that large
+constexpr int MAX_TEMPORAL_STEPS = 8;
+// Smallest GL_MAX_COMPUTE_WORK_GROUP_COUNT any implementation has to support, as gol_tiles.comp assumes too
+constexpr int MAX_WORK_GROUPS = 65535;
 
-    auto image = std::vector<float>(width * height);
-    for (auto& pixel : image) {
-        pixel = rng() > proba ? 1.0f : 0.0f;
+// Linked step programs are kept there, one binary per variant and driver
+const std::filesystem::path SHADER_CACHE_DIR = "shader_cache";
+
+// Parts of a frame timed by the profiler, in order. The legacy copy back is part of the step.
+enum FramePhase { PHASE_POLL, PHASE_STEP, PHASE_DISPLAY, PHASE_UI_BUILD, PHASE_UI_RENDER, PHASE_SWAP };
+// Where "Dump profile" writes the profiler's history
+const std::filesystem::path PROFILE_FILE = "profile.csv";
+
+// Cell x of a row goes to bit x % 32 of word x / 32, as gol_packed.comp stores them
+std::vector<GLuint> packCells(const float* cells, int width, int height) {
+    int words = (width + 31) / 32;
+    auto packed = std::vector<GLuint>(size_t(words) * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (cells[size_t(y) * width + x] > 0.5f) {
+                packed[size_t(y) * words + x / 32] |= 1u << (x % 32);
+            }
+        }
+    }
+    return packed;
+}
+
+// A BitGrid row is the same bytes as the packed texels of that row on a little-endian host, with a guard word on
+// either side, so grids go to and from packed textures with a row length instead of a conversion
+static_assert(std::endian::native == std::endian::little);
+
+// Patterns and images are decoded on a worker thread, already at the size of the universe they go to
+struct LoadedPattern {
+    std::string path;
+    // Only when the file names a rule the rule table can express
+    bool has_rule = false;
+    int rules[RULE_COUNT] = {};
+    BitGrid grid;
+    // Snapshots also bring back the generation and the soup seed
+    std::optional<SnapshotInfo> snapshot;
+};
+
+LoadedPattern loadPattern(const std::string& path, glm::ivec2 universe_size, glm::ivec2 max_size, bool fit) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error(std::format("{} not found", path));
+    }
+    LoadedPattern pattern{path};
+    if (path.ends_with(".snap")) {
+        // Checkpoints come back at their own size, whatever the fit setting
+        SnapshotFile snapshot(path);
+        const SnapshotInfo& info = snapshot.info();
+        if (info.width > max_size.x || info.height > max_size.y) {
+            throw std::runtime_error(std::format("{}x{} does not fit this storage", info.width, info.height));
+        }
+        pattern.grid = BitGrid(info.width, info.height);
+        snapshot.readInto(pattern.grid);
+        pattern.has_rule = true;
+        std::copy(info.rules, info.rules + RULE_COUNT, pattern.rules);
+        pattern.snapshot = info;
+        return pattern;
+    }
+    auto make_universe = [&](int64_t width, int64_t height) {
+        glm::ivec2 size = universe_size;
+        if (fit) {
+            glm::ivec2 pattern_size(int(std::min<int64_t>(width, INT_MAX)), int(std::min<int64_t>(height, INT_MAX)));
+            size = glm::clamp(pattern_size, glm::ivec2(1), max_size);
+        }
+        pattern.grid = BitGrid(size.x, size.y);
+    };
+    if (!path.ends_with(".mc") && !path.ends_with(".rle")) {
+        ImageSize size = imageSize(path);
+        make_universe(size.width, size.height);
+        loadImage(path, pattern.grid);
+    } else if (path.ends_with(".mc")) {
+        // Only the part of the quadtree the universe can hold, around the pattern's center, is expanded to cells
+        HashLife life = macrocellStore();
+        MacrocellHeader header = readMacrocell(file, life);
+        int64_t left = 0, top = 0, right = 0, bottom = 0;
+        life.bounds(left, top, right, bottom);
+        make_universe(right - left, bottom - top);
+        life.storeGrid(
+            pattern.grid, left + (right - left - pattern.grid.width()) / 2,
+            top + (bottom - top - pattern.grid.height()) / 2
+        );
+        pattern.has_rule = header.has_rule;
+        std::copy(header.rules, header.rules + RULE_COUNT, pattern.rules);
+    } else {
+        RleReader reader(file);
+        const RleHeader& header = reader.header();
+        make_universe(header.width, header.height);
+        reader.readInto(
+            pattern.grid, (pattern.grid.width() - header.width) / 2, (pattern.grid.height() - header.height) / 2
+        );
+        pattern.has_rule = header.has_rule;
+        std::copy(header.rules, header.rules + RULE_COUNT, pattern.rules);
     }
+    return pattern;
+}
 
-    return image;
+std::vector<float> unpackCells(const std::vector<GLuint>& packed, int width, int height) {
+    int words = (width + 31) / 32;
+    auto cells = std::vector<float>(size_t(width) * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            cells[size_t(y) * width + x] = packed[size_t(y) * words + x / 32] >> (x % 32) & 1 ? 1.0f : 0.0f;
+        }
+    }
+    return cells;
 }
 
-std::string openFile() {
-    FILE* pipe = popen("kdialog --getopenfilename . '*.png *.jpg *.jpeg *.bmp *.tga'", "r");
+// Path picked in a kdialog file dialog, `mode` being getopenfilename or getsavefilename, empty when cancelled
+std::string fileDialog(const char* mode, const char* filter) {
+    FILE* pipe = popen(std::format("kdialog --{} . '{}'", mode, filter).c_str(), "r");
     if (!pipe) {
         return "";
     }
@@ -58,6 +188,30 @@ std::string openFile() {
     return result.substr(0, result.length() - 1);
 };
 
+struct StepProgram {
+    GLuint program;
+    GLint u_resolution;
+    GLint u_cursor_pos;
+    GLint u_cursor_down;
+    GLint u_paused;
+    GLint u_tiles;
+    GLint u_birth;
+    GLint u_keep;
+};
+
+StepProgram loadStepProgram(const std::filesystem::path& file, const std::string& defines = "") {
+    StepProgram step;
+    step.program = loadCachedComputeProgram(file, defines, SHADER_CACHE_DIR);
+    step.u_resolution = glGetUniformLocation(step.program, "u_resolution");
+    step.u_cursor_pos = glGetUniformLocation(step.program, "u_cursor_pos");
+    step.u_cursor_down = glGetUniformLocation(step.program, "u_cursor_down");
+    step.u_paused = glGetUniformLocation(step.program, "u_paused");
+    step.u_tiles = glGetUniformLocation(step.program, "u_tiles");
+    step.u_birth = glGetUniformLocation(step.program, "u_birth");
+    step.u_keep = glGetUniformLocation(step.program, "u_keep");
+    return step;
+}
+
 const char* ruleValue(int rule_val) {
     if (rule_val == 0) {
         return "X";
@@ -70,6 +224,28 @@ const char* ruleValue(int rule_val) {
 }
 
 int main(int argc, const char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--headless") {
+            return runHeadless(argc, argv);
+        }
+    }
+    std::cout << std::format("CPU kernel: {}", kernelIsaName(kernelIsa())) << std::endl;
+
+    glm::ivec2 buffer_size(DEFAULT_BUFFER_WIDTH, DEFAULT_BUFFER_HEIGHT);
+    int tile_size = DEFAULT_TILE_SIZE;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--size" && sscanf(argv[i + 1], "%dx%d", &buffer_size.x, &buffer_size.y) != 2) {
+            fprintf(stderr, "Expected --size WIDTHxHEIGHT, got %s\n", argv[i + 1]);
+            return -1;
+        }
+        if (std::string(argv[i]) == "--tile-size" && sscanf(argv[i + 1], "%d", &tile_size) != 1) {
+            fprintf(stderr, "Expected --tile-size N, got %s\n", argv[i + 1]);
+            return -1;
+        }
+    }
+    // 32x32 is the largest workgroup every implementation supports
+    tile_size = std::clamp(tile_size, MAX_TEMPORAL_STEPS, 32);
+
     glfwSetErrorCallback([](int error, const char* description) { fprintf(stderr, "Error: %s\n", description); });
     if (!glfwInit()) {
         return -1;
@@ -87,54 +263,451 @@ int main(int argc, const char* argv[]) {
     GLuint framebuffer = createFramebuffer(framebuffer_texture);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    auto image = getRandomImage(BUFFER_WIDTH, BUFFER_HEIGHT);
-    GLuint buffer1 = createTexture(BUFFER_WIDTH, BUFFER_HEIGHT, GL_R32F, GL_RED, GL_FLOAT, image.data());
-    GLuint buffer2 = createTexture(BUFFER_WIDTH, BUFFER_HEIGHT, GL_R32F, GL_RED, GL_FLOAT);
-    glBindImageTexture(0, buffer1, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
-    glBindImageTexture(1, buffer2, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+    GLint max_texture_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    buffer_size = glm::clamp(buffer_size, glm::ivec2(1), glm::ivec2(max_texture_size));
+
+    int rules[RULE_COUNT] = {0, 0, 2, 1, 0, 0, 0, 0, 0};
+    bool is_updated = false;
+    // The rule in use, rules[] can hold edits not applied yet
+    RuleMasks rule_masks = compileRules(rules);
 
-    GLuint compute = loadComputeProgram("resources/gol.comp");
+    // full_step is the original one invocation per workgroup kernel, shared_step and tiled_step step whole tiles
+    // through shared memory, temporal_steps generations per dispatch, tiled_step only on the listed tiles.
+    // packed_step works on bit-packed state, 32 cells per r32ui texel.
+    // With specialize_rules the rule is compiled into every variant as constants instead of read from uniforms,
+    // so applying a new rule reloads them, from the shader cache after the first time.
+    StepProgram full_step = {};
+    StepProgram shared_step = {};
+    StepProgram tiled_step = {};
+    StepProgram packed_step = {};
+    bool use_shared_memory = true;
+    bool specialize_rules = true;
+    int temporal_steps = 1;
+    auto load_step_programs = [&] {
+        for (auto* step : {&full_step, &shared_step, &tiled_step, &packed_step}) {
+            glDeleteProgram(step->program);
+        }
+        std::string rule_defines;
+        if (specialize_rules) {
+            rule_defines =
+                std::format("#define BIRTH_MASK {}u\n#define KEEP_MASK {}u\n", rule_masks.birth, rule_masks.keep);
+        }
+        auto tile_defines = std::format(
+            "#define SHARED_MEMORY\n#define TILE_SIZE {}\n#define TEMPORAL_STEPS {}\n", tile_size, temporal_steps
+        );
+        full_step = loadStepProgram("resources/gol.comp", rule_defines);
+        shared_step = loadStepProgram("resources/gol.comp", rule_defines + tile_defines);
+        tiled_step = loadStepProgram("resources/gol.comp", rule_defines + "#define ACTIVE_TILES\n" + tile_defines);
+        packed_step = loadStepProgram("resources/gol_packed.comp", rule_defines);
+    };
+    load_step_programs();
+    bool packed_storage = false;
+    GLuint tile_list = loadComputeProgram("resources/gol_tiles.comp");
     GLuint display = loadShaderProgram("resources/gol.vert", "resources/gol.frag");
 
+    GLuint packed_display = loadShaderProgram("resources/gol.vert", "resources/gol_packed.frag");
+
     GLint u_texture = glGetUniformLocation(display, "u_texture");
+    GLint u_packed_texture = glGetUniformLocation(packed_display, "u_texture");
+    GLint u_packed_resolution = glGetUniformLocation(packed_display, "u_resolution");
 
-    GLint u_resolution = glGetUniformLocation(compute, "u_resolution");
-    auto u_cursor_pos = glGetUniformLocation(compute, "u_cursor_pos");
-    auto u_cursor_down = glGetUniformLocation(compute, "u_cursor_down");
-    auto u_paused = glGetUniformLocation(compute, "u_paused");
+    GLint u_list_tiles = glGetUniformLocation(tile_list, "u_tiles");
+    GLint u_force_all = glGetUniformLocation(tile_list, "u_force_all");
+    GLint u_cursor_tile = glGetUniformLocation(tile_list, "u_cursor_tile");
 
-    GLint u_rules[9] = {glGetUniformLocation(compute, "u_rules[0]"), glGetUniformLocation(compute, "u_rules[1]"),
-                        glGetUniformLocation(compute, "u_rules[2]"), glGetUniformLocation(compute, "u_rules[3]"),
-                        glGetUniformLocation(compute, "u_rules[4]"), glGetUniformLocation(compute, "u_rules[5]"),
-                        glGetUniformLocation(compute, "u_rules[6]"), glGetUniformLocation(compute, "u_rules[7]")};
+    // Random soups are generated on the GPU, one program per storage format
+    GLuint soups[2] = {
+        loadComputeProgram("resources/gol_soup.comp"),
+        loadComputeProgram("resources/gol_soup.comp", "#define PACKED\n"),
+    };
+
+    // Active tile tracking: per tile "changed during the last generation" flags for the previous and current
+    // generations, the compacted list of tiles to recompute, and the indirect dispatch arguments followed by
+    // the length of the list
+    int tiles_x = 0;
+    int tiles_y = 0;
+    int tile_count = 0;
+    GLuint active_tiles = 0;
+    GLuint changed_tiles[2] = {0, 0};
+    GLuint tile_dispatch = createBuffer(4 * sizeof(GLuint));
+    bool skip_stable_tiles = false;
+    bool force_all_tiles = true;
+    float skipped_tiles = 0;
+    // The list length of a batch's last listing is copied to one of two persistently mapped slots and read once its
+    // fence has signaled, frames later, so the skipped tile statistic never waits on the GPU
+    const GLbitfield readback_flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLuint listed_tiles_buffer = createBuffer(2 * sizeof(GLuint), nullptr, readback_flags);
+    auto listed_tiles = static_cast<const GLuint*>(
+        glMapNamedBufferRange(listed_tiles_buffer, 0, 2 * sizeof(GLuint), readback_flags)
+    );
+    GLsync listed_tiles_fences[2] = {nullptr, nullptr};
+    int listed_tiles_totals[2] = {0, 0};
+    // The slot written next, the older one when both are in flight
+    int listed_tiles_slot = 0;
+
+    auto set_step_uniforms = [&] {
+        // The shaders test neighbor counts against the same birth and keep masks as the CPU kernels, specialized
+        // programs have them as constants and no such uniforms
+        for (auto* step : {&full_step, &shared_step, &tiled_step, &packed_step}) {
+            glUseProgram(step->program);
+            glUniform2i(step->u_resolution, buffer_size.x, buffer_size.y);
+            glUniform2i(step->u_tiles, tiles_x, tiles_y);
+            glUniform1ui(step->u_birth, rule_masks.birth);
+            glUniform1ui(step->u_keep, rule_masks.keep);
+        }
+        glUseProgram(tile_list);
+        glUniform2i(u_list_tiles, tiles_x, tiles_y);
+        glUseProgram(packed_display);
+        glUniform2i(u_packed_resolution, buffer_size.x, buffer_size.y);
+    };
+
+    // The two state textures take turns as input and output, buffers[front] holds the current generation and is
+    // the one displayed. legacy_copy steps into the other one and copies it back instead, for comparison.
+    GLuint buffers[2] = {0, 0};
+    int front = 0;
+    bool legacy_copy = false;
+    float gen_proba = .05;
+    // Seed of the last soup, the same seed and probability give the same soup back
+    uint64_t soup_seed = std::random_device()() | uint64_t(std::random_device()()) << 32;
+    // Generations stepped since the universe was last filled, kept in snapshots
+    uint64_t generation = 0;
+    auto texture_width = [&] {
+        return packed_storage ? (buffer_size.x + 31) / 32 : buffer_size.x;
+    };
+    // Both textures get the new state: tiles skipped by the next generations keep whatever the output had.
+    // `state` is in the storage format, one float per cell or packed words, and clears the universe when null.
+    auto set_state = [&](const void* state) {
+        GLenum format = packed_storage ? GL_RED_INTEGER : GL_RED;
+        GLenum type = packed_storage ? GL_UNSIGNED_INT : GL_FLOAT;
+        for (GLuint buffer : buffers) {
+            if (state) {
+                uploadTexture(buffer, texture_width(), buffer_size.y, format, type, state);
+            } else {
+                glClearTexImage(buffer, 0, format, type, nullptr);
+            }
+        }
+        force_all_tiles = true;
+    };
+    auto set_cells = [&](const float* cells) {
+        if (packed_storage && cells) {
+            set_state(packCells(cells, buffer_size.x, buffer_size.y).data());
+        } else {
+            set_state(cells);
+        }
+    };
+    auto get_cells = [&] {
+        if (packed_storage) {
+            std::vector<GLuint> packed(size_t(texture_width()) * buffer_size.y);
+            getTexture(buffers[front], GL_RED_INTEGER, GL_UNSIGNED_INT, packed.data());
+            return unpackCells(packed, buffer_size.x, buffer_size.y);
+        }
+        std::vector<float> cells(size_t(buffer_size.x) * buffer_size.y);
+        getTexture(buffers[front], GL_RED, GL_FLOAT, cells.data());
+        return cells;
+    };
+    // Same as set_cells and get_cells with BitGrid rows, which packed storage takes as they are
+    auto set_grid = [&](const BitGrid& grid) {
+        if (packed_storage) {
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, grid.stride() * 2);
+            set_state(grid.row(0));
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            return;
+        }
+        // Float textures take a byte per cell just as well, 255 becoming 1
+        std::vector<uint8_t> cells(size_t(buffer_size.x) * buffer_size.y);
+        for (int y = 0; y < buffer_size.y; y++) {
+            for (int x = 0; x < buffer_size.x; x++) {
+                cells[size_t(y) * buffer_size.x + x] = grid.get(x, y) ? 255 : 0;
+            }
+        }
+        for (GLuint buffer : buffers) {
+            uploadTexture(buffer, buffer_size.x, buffer_size.y, GL_RED, GL_UNSIGNED_BYTE, cells.data());
+        }
+        force_all_tiles = true;
+    };
+    auto get_grid = [&] {
+        BitGrid grid(buffer_size.x, buffer_size.y);
+        if (packed_storage) {
+            glPixelStorei(GL_PACK_ROW_LENGTH, grid.stride() * 2);
+            getTexture(buffers[front], GL_RED_INTEGER, GL_UNSIGNED_INT, grid.row(0));
+            glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+            return grid;
+        }
+        auto cells = get_cells();
+        for (int y = 0; y < buffer_size.y; y++) {
+            for (int x = 0; x < buffer_size.x; x++) {
+                grid.set(x, y, cells[size_t(y) * buffer_size.x + x] > 0.5f);
+            }
+        }
+        return grid;
+    };
+    auto regenerate = [&] {
+        GLuint soup = soups[packed_storage];
+        GLenum image_format = packed_storage ? GL_R32UI : GL_R32F;
+        glUseProgram(soup);
+        glUniform2i(glGetUniformLocation(soup, "u_resolution"), buffer_size.x, buffer_size.y);
+        glUniform2ui(glGetUniformLocation(soup, "u_seed"), GLuint(soup_seed), GLuint(soup_seed >> 32));
+        glUniform1ui(glGetUniformLocation(soup, "u_threshold"), RandomNumberGenerator::soupThreshold(gen_proba));
+        glBindImageTexture(0, buffers[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, image_format);
+        glBindImageTexture(1, buffers[1], 0, GL_FALSE, 0, GL_WRITE_ONLY, image_format);
+        glDispatchCompute((texture_width() + 7) / 8, (buffer_size.y + 7) / 8, 1);
+        glMemoryBarrier(
+            GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT
+        );
+        force_all_tiles = true;
+        generation = 0;
+    };
+    // Packed textures hold 32 cells per texel, so the universe can be 32 times wider
+    auto max_size = [&] {
+        return glm::ivec2(packed_storage ? 32 * max_texture_size : max_texture_size, max_texture_size);
+    };
+
+    // The state textures and everything sized after them are reallocated together, `cells` (one float per cell)
+    // fills the new universe when given
+    glm::ivec2 size_input = buffer_size;
+    auto resize_universe = [&](glm::ivec2 size, const float* cells) {
+        glDeleteTextures(2, buffers);
+        glDeleteBuffers(1, &active_tiles);
+        glDeleteBuffers(2, changed_tiles);
+
+        buffer_size = size;
+        size_input = size;
+        GLenum internalformat = packed_storage ? GL_R32UI : GL_R32F;
+        buffers[0] = createTextureStorage(texture_width(), size.y, internalformat);
+        buffers[1] = createTextureStorage(texture_width(), size.y, internalformat);
+        front = 0;
+        set_cells(cells);
+        glBindTextureUnit(0, buffers[front]);
+
+        tiles_x = (size.x + tile_size - 1) / tile_size;
+        tiles_y = (size.y + tile_size - 1) / tile_size;
+        tile_count = tiles_x * tiles_y;
+        active_tiles = createBuffer(tile_count * sizeof(GLuint));
+        changed_tiles[0] = createBuffer(tile_count * sizeof(GLuint));
+        changed_tiles[1] = createBuffer(tile_count * sizeof(GLuint));
+        force_all_tiles = true;
+        set_step_uniforms();
+    };
+    // Keeps the current cells, centered, when the size or the storage format changes. Packed universes go through
+    // bit rows, a float per cell would not even fit in memory for the widest of them.
+    auto resize_keeping_cells = [&](glm::ivec2 size, bool packed) {
+        if (!packed_storage && !packed) {
+            CellImage current{buffer_size.x, buffer_size.y, get_cells()};
+            size = glm::clamp(size, glm::ivec2(1), max_size());
+            resize_universe(size, placeImage(current, size.x, size.y).data());
+            return;
+        }
+        BitGrid current = get_grid();
+        packed_storage = packed;
+        size = glm::clamp(size, glm::ivec2(1), max_size());
+        BitGrid placed(size.x, size.y);
+        placed.paste(current, (size.x - current.width()) / 2, (size.y - current.height()) / 2);
+        resize_universe(size, nullptr);
+        set_grid(placed);
+    };
+    bool fit_to_image = true;
+
+    // GPU time of the last batches of steps, two queries in flight so reading one never waits on the GPU
+    GLuint step_queries[2];
+    glCreateQueries(GL_TIME_ELAPSED, 2, step_queries);
+    bool step_query_issued[2] = {false, false};
+    int step_query_dispatches[2] = {0, 0};
+    int step_query = 0;
+    float step_time = 0;
+
+    // Steps on the CPU through LutEngine's block table instead of the step shaders. The state textures stay the
+    // reference, read back, stepped and uploaded again every frame, so everything else keeps working on them.
+    std::unique_ptr<LutEngine> lut_engine;
 
-    int rules[9] = {0, 0, 2, 1, 0, 0, 0, 0};
-    bool is_updated = false;
     auto update_rules = [&] {
-        glUseProgram(compute);
-        for (int i = 0; i < 9; i++) {
-            glUniform1i(u_rules[i], rules[i]);
+        RuleMasks masks = compileRules(rules);
+        bool changed = masks.birth != rule_masks.birth || masks.keep != rule_masks.keep;
+        rule_masks = masks;
+        if (specialize_rules && changed) {
+            load_step_programs();
         }
+        if (lut_engine) {
+            lut_engine->setRules(rule_masks);
+        }
+        set_step_uniforms();
         is_updated = true;
+        force_all_tiles = true;
     };
-    float gen_proba = .05;
 
-    int framerate = FRAMERATE;
     bool is_paused = false;
+    // Generations to step per second, or as many dispatches as fit MAX_SPEED_BUDGET_MS per frame with max_speed.
+    // Shared memory dispatches step temporal_steps generations each.
+    int generation_rate = DEFAULT_GENERATION_RATE;
+    bool max_speed = false;
+    int batch_size = 1;
+    double pending_generations = 0;
+    // Generations stepped over the last half second
+    double rate_window_start = glfwGetTime();
+    int counted_generations = 0;
+    double achieved_rate = 0;
 
     glUseProgram(display);
-    glBindTexture(GL_TEXTURE_2D, buffer2);
     glActiveTexture(GL_TEXTURE0);
     glUniform1i(u_texture, 0);
+    glUseProgram(packed_display);
+    glUniform1i(u_packed_texture, 0);
 
-    glUseProgram(compute);
+    resize_universe(buffer_size, nullptr);
+    regenerate();
     update_rules();
-    glUniform2i(u_resolution, BUFFER_WIDTH, BUFFER_HEIGHT);
 
     std::string file_path;
+    std::future<LoadedPattern> pattern_loading;
+    // Images large enough to be worth it are decoded in bands, uploaded as they come while the universe is held
+    std::unique_ptr<ImageBandReader> image_streaming;
+
+    // A snapshot being saved: the state texture is read back into a buffer without stalling, fenced, then written
+    // out by a worker thread straight from the mapped buffer, which stays mapped until the worker is done
+    struct SnapshotSave {
+        std::string path;
+        SnapshotInfo info;
+        bool packed = false;
+        GLuint buffer = 0;
+        GLsizeiptr size = 0;
+        GLsync fence = nullptr;
+        std::future<void> writing;
+    };
+    std::optional<SnapshotSave> snapshot_save;
+    bool compress_snapshots = false;
+    auto save_snapshot = [&](const std::string& path) {
+        SnapshotSave& save = snapshot_save.emplace();
+        save.path = path;
+        save.info.width = buffer_size.x;
+        save.info.height = buffer_size.y;
+        std::copy(rules, rules + RULE_COUNT, save.info.rules);
+        save.info.generation = generation;
+        save.info.seed = soup_seed;
+        save.packed = packed_storage;
+        // Packed rows are read back as BitGrid rows without guard words, the bits past the width being ignored
+        int words = (buffer_size.x + 63) / 64;
+        save.size = GLsizeiptr(packed_storage ? words * 8 : buffer_size.x * 4) * buffer_size.y;
+        save.buffer = createBuffer(save.size, nullptr, GL_MAP_READ_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, save.buffer);
+        if (packed_storage) {
+            glPixelStorei(GL_PACK_ROW_LENGTH, words * 2);
+            getTexture(buffers[front], GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+            glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+        } else {
+            getTexture(buffers[front], GL_RED, GL_FLOAT, nullptr);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        save.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    };
+    auto poll_snapshot_save = [&] {
+        SnapshotSave& save = *snapshot_save;
+        if (save.fence) {
+            GLenum status = glClientWaitSync(save.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                return;
+            }
+            glDeleteSync(save.fence);
+            save.fence = nullptr;
+            const void* data = glMapNamedBufferRange(save.buffer, 0, save.size, GL_MAP_READ_BIT);
+            save.writing = std::async(std::launch::async, [&save, data, compress = compress_snapshots] {
+                if (save.packed) {
+                    auto rows = static_cast<const uint64_t*>(data);
+                    writeSnapshot(save.path, save.info, rows, (save.info.width + 63) / 64, compress);
+                    return;
+                }
+                auto cells = static_cast<const float*>(data);
+                BitGrid grid(save.info.width, save.info.height);
+                for (int y = 0; y < grid.height(); y++) {
+                    for (int x = 0; x < grid.width(); x++) {
+                        grid.set(x, y, cells[size_t(y) * grid.width() + x] > 0.5f);
+                    }
+                }
+                writeSnapshot(save.path, save.info, grid.row(0), grid.stride(), compress);
+            });
+            return;
+        }
+        if (save.writing.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+        try {
+            save.writing.get();
+        } catch (const std::exception& error) {
+            fprintf(stderr, "%s\n", error.what());
+        }
+        glUnmapNamedBuffer(save.buffer);
+        glDeleteBuffers(1, &save.buffer);
+        snapshot_save.reset();
+    };
+    // Uncompressed snapshots in packed storage are uploaded from the file mapping as they are, pages being read in
+    // as the upload goes; anything else is decoded on the loading thread. False when it has to be, or when the file
+    // does not open, for the loading thread to report why.
+    auto open_snapshot = [&](const std::string& path) {
+        std::optional<SnapshotFile> snapshot;
+        try {
+            snapshot.emplace(path);
+        } catch (const std::exception&) {
+            return false;
+        }
+        const SnapshotInfo& info = snapshot->info();
+        if (!packed_storage || !snapshot->rows() || info.width > max_size().x || info.height > max_size().y) {
+            return false;
+        }
+        resize_universe(glm::ivec2(info.width, info.height), nullptr);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, snapshot->words() * 2);
+        set_state(snapshot->rows());
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        std::copy(info.rules, info.rules + RULE_COUNT, rules);
+        update_rules();
+        generation = info.generation;
+        soup_seed = info.seed;
+        return true;
+    };
+    // Formats ImageStream reads start streaming into a cleared universe of the image's size, or of the current one.
+    // False for the others, or when the file does not open, for the loading thread to report why.
+    auto open_image_stream = [&](const std::string& path) {
+        if (!ImageStream::supports(path)) {
+            return false;
+        }
+        std::optional<ImageStream> stream;
+        try {
+            stream.emplace(path);
+        } catch (const std::exception&) {
+            return false;
+        }
+        glm::ivec2 size = buffer_size;
+        if (fit_to_image) {
+            size = glm::clamp(glm::ivec2(stream->width(), stream->height()), glm::ivec2(1), max_size());
+        }
+        resize_universe(size, nullptr);
+        generation = 0;
+        image_streaming = std::make_unique<ImageBandReader>(std::move(*stream), size.x, size.y);
+        return true;
+    };
+    // Rows of a band into both textures, as they are in packed storage and a byte per cell otherwise
+    auto set_band = [&](const ImageBand& band) {
+        if (packed_storage) {
+            for (GLuint buffer : buffers) {
+                uploadTextureRows(
+                    buffer, band.y, texture_width(), band.rows, band.words * 2, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                    band.bits.data()
+                );
+            }
+        } else {
+            std::vector<uint8_t> cells(size_t(buffer_size.x) * band.rows);
+            for (int y = 0; y < band.rows; y++) {
+                const uint64_t* row = band.bits.data() + size_t(y) * band.words;
+                for (int x = 0; x < buffer_size.x; x++) {
+                    cells[size_t(y) * buffer_size.x + x] = row[x / 64] >> (x % 64) & 1 ? 255 : 0;
+                }
+            }
+            for (GLuint buffer : buffers) {
+                uploadTextureRows(buffer, band.y, buffer_size.x, band.rows, 0, GL_RED, GL_UNSIGNED_BYTE, cells.data());
+            }
+        }
+        force_all_tiles = true;
+    };
     glm::vec2 screen_pos = glm::vec2(0);
     glm::vec2 screen_size = glm::vec2(0);
-    glm::vec2 BUFFER_SIZE = glm::vec2(BUFFER_WIDTH, BUFFER_HEIGHT);
 
     struct State {
         glm::vec2 res = glm::vec2(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -155,41 +728,252 @@ int main(int argc, const char* argv[]) {
         state.cursor_down = action == GLFW_PRESS;
     });
 
+    // One dispatch, `cursor` in cells
+    auto step_dispatch = [&](glm::vec2 cursor) {
+        // Paused generations change nothing, tracking would see every tile as stable and never wake them up
+        bool use_tiles = skip_stable_tiles && !is_paused && !packed_storage;
+        if (use_tiles) {
+            // Both buffers were last written by shaders
+            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+            const GLuint empty_dispatch[4] = {0, 1, 1, 0};
+            glNamedBufferSubData(tile_dispatch, 0, sizeof(empty_dispatch), empty_dispatch);
+            glClearNamedBufferData(changed_tiles[1], GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+            // A dispatch reads cells temporal_steps away from a tile, which must stay within its 3x3 neighborhood for
+            // a stable one to be skipped. Tiles on the last row or column can be narrower than that.
+            int last_width = buffer_size.x - (tiles_x - 1) * tile_size;
+            int last_height = buffer_size.y - (tiles_y - 1) * tile_size;
+            bool tiles_fit = (tiles_x <= 3 || temporal_steps <= last_width) &&
+                             (tiles_y <= 3 || temporal_steps <= last_height);
+
+            glUseProgram(tile_list);
+            glUniform1i(u_force_all, force_all_tiles || !tiles_fit);
+            if (state.cursor_down) {
+                glUniform2i(u_cursor_tile, int(cursor.x) / tile_size, int(cursor.y) / tile_size);
+            } else {
+                glUniform2i(u_cursor_tile, -1, -1);
+            }
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, active_tiles);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, changed_tiles[0]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, tile_dispatch);
+            // Capped like the step's indirect dispatch, the listing's invocations loop over the remaining tiles
+            glDispatchCompute(std::min((tile_count + 63) / 64, MAX_WORK_GROUPS), 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+            force_all_tiles = false;
+        }
+
+        const StepProgram& step = packed_storage      ? packed_step
+                                  : use_tiles         ? tiled_step
+                                  : use_shared_memory ? shared_step
+                                                      : full_step;
+        GLenum image_format = packed_storage ? GL_R32UI : GL_R32F;
+        glUseProgram(step.program);
+        glUniform2i(step.u_cursor_pos, cursor.x, cursor.y);
+        glUniform1i(step.u_cursor_down, state.cursor_down);
+        glUniform1i(step.u_paused, is_paused);
+        glBindImageTexture(0, buffers[front], 0, GL_FALSE, 0, GL_READ_WRITE, image_format);
+        glBindImageTexture(1, buffers[1 - front], 0, GL_FALSE, 0, GL_READ_WRITE, image_format);
+        if (packed_storage) {
+            glDispatchCompute((texture_width() + 7) / 8, (buffer_size.y + 7) / 8, 1);
+            force_all_tiles = true;
+        } else if (use_tiles) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, changed_tiles[1]);
+            glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, tile_dispatch);
+            glDispatchComputeIndirect(0);
+            std::swap(changed_tiles[0], changed_tiles[1]);
+        } else if (use_shared_memory) {
+            glDispatchCompute(
+                (buffer_size.x + tile_size - 1) / tile_size, (buffer_size.y + tile_size - 1) / tile_size, 1
+            );
+            force_all_tiles = true;
+        } else {
+            glDispatchCompute(buffer_size.x, buffer_size.y, 1);
+            force_all_tiles = true;
+        }
+        // The changed tile flags are read by the next listing
+        glMemoryBarrier(
+            GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT
+        );
+        if (legacy_copy) {
+            glCopyImageSubData(
+                buffers[1 - front], GL_TEXTURE_2D, 0, 0, 0, 0, buffers[front], GL_TEXTURE_2D, 0, 0, 0, 0,
+                texture_width(), buffer_size.y, 1
+            );
+        } else {
+            front = 1 - front;
+            glBindTextureUnit(0, buffers[front]);
+        }
+    };
+
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 460");
 
+    // Freed with the other GL objects, before the window and its context
+    auto profiler = std::make_unique<FrameProfiler>(
+        std::vector<std::string>{"Poll events", "Step", "Display", "UI build", "UI render", "Swap"}
+    );
+
     double last_time = glfwGetTime();
     do {
+        profiler->beginFrame();
         double current_time = glfwGetTime();
         double elapsed_time = current_time - last_time;
+        profiler->begin(PHASE_POLL);
         glfwPollEvents();
+        profiler->end(PHASE_POLL);
+        if (snapshot_save) {
+            poll_snapshot_save();
+        }
+
+        if (pattern_loading.valid() && pattern_loading.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            try {
+                LoadedPattern pattern = pattern_loading.get();
+                resize_universe(glm::ivec2(pattern.grid.width(), pattern.grid.height()), nullptr);
+                set_grid(pattern.grid);
+                if (pattern.has_rule) {
+                    std::copy(pattern.rules, pattern.rules + RULE_COUNT, rules);
+                    update_rules();
+                }
+                generation = pattern.snapshot ? pattern.snapshot->generation : 0;
+                if (pattern.snapshot) {
+                    soup_seed = pattern.snapshot->seed;
+                }
+            } catch (const std::exception& error) {
+                fprintf(stderr, "%s\n", error.what());
+            }
+        }
+        if (image_streaming) {
+            try {
+                ImageBand band;
+                while (image_streaming->next(band, false)) {
+                    set_band(band);
+                }
+                if (image_streaming->finished()) {
+                    image_streaming.reset();
+                }
+            } catch (const std::exception& error) {
+                fprintf(stderr, "%s\n", error.what());
+                image_streaming.reset();
+            }
+        }
 
         glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
         glViewport(0, 0, FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT);
         glClear(GL_COLOR_BUFFER_BIT);
-        if (elapsed_time > 1.f / framerate) {
-            glUseProgram(compute);
-            auto pos = state.cursor_pos * BUFFER_SIZE / screen_size - screen_pos / 2.f;
-            glUniform2i(u_cursor_pos, pos.x, pos.y);
-            glUniform1i(u_cursor_down, state.cursor_down);
-            glUniform1i(u_paused, is_paused);
-            glBindImageTexture(0, buffer1, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
-            glBindImageTexture(1, buffer2, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
-            glDispatchCompute(BUFFER_WIDTH, BUFFER_HEIGHT, 1);
-            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-            glCopyImageSubData(
-                buffer2, GL_TEXTURE_2D, 0, 0, 0, 0, buffer1, GL_TEXTURE_2D, 0, 0, 0, 0, BUFFER_WIDTH, BUFFER_HEIGHT, 1
-            );
-            last_time = current_time;
+        profiler->begin(PHASE_STEP);
+        // Dispatches owed since the last frame at the target rate, or a batch sized to the time budget. Paused
+        // steps only apply the cursor, one per frame is enough.
+        int per_dispatch = !packed_storage && (use_shared_memory || skip_stable_tiles) ? temporal_steps : 1;
+        int dispatches;
+        if (max_speed) {
+            dispatches = batch_size;
+        } else {
+            pending_generations += elapsed_time * generation_rate;
+            dispatches = std::min(int(pending_generations / per_dispatch), MAX_DISPATCHES_PER_FRAME);
+            pending_generations = std::min(pending_generations - dispatches * per_dispatch, double(per_dispatch));
+        }
+        if (is_paused) {
+            dispatches = std::min(dispatches, 1);
+        }
+        // Half an image would start evolving before the rest of it arrives
+        if (image_streaming) {
+            dispatches = 0;
+        }
+        last_time = current_time;
+        if (dispatches > 0 && lut_engine) {
+            // The table engine takes no cursor, paused frames have nothing to do
+            if (!is_paused) {
+                int generations = dispatches * per_dispatch;
+                if (lut_engine->width() != buffer_size.x || lut_engine->height() != buffer_size.y) {
+                    lut_engine = std::make_unique<LutEngine>(buffer_size.x, buffer_size.y);
+                    lut_engine->setRules(rule_masks);
+                }
+                lut_engine->grid() = get_grid();
+                lut_engine->step(generations);
+                set_grid(lut_engine->grid());
+                counted_generations += generations;
+                generation += generations;
+            }
+        } else if (dispatches > 0) {
+            // The query issued two batches ago is usually done by now. When it is not, this batch goes untimed rather
+            // than waiting for it, and the query is kept until its result comes.
+            GLint available = GL_TRUE;
+            if (step_query_issued[step_query]) {
+                glGetQueryObjectiv(step_queries[step_query], GL_QUERY_RESULT_AVAILABLE, &available);
+            }
+            bool timed = available;
+            if (timed && step_query_issued[step_query]) {
+                GLuint64 nanoseconds;
+                glGetQueryObjectui64v(step_queries[step_query], GL_QUERY_RESULT, &nanoseconds);
+                step_time = nanoseconds / 1e6f;
+                if (max_speed && !is_paused) {
+                    // Grows or shrinks the batch in proportion to how far its time is from the budget
+                    float per_step = step_time / step_query_dispatches[step_query];
+                    int fitting = per_step > 0 ? int(MAX_SPEED_BUDGET_MS / per_step) : batch_size * 2;
+                    batch_size = std::clamp((batch_size + fitting) / 2, 1, MAX_DISPATCHES_PER_FRAME);
+                }
+            }
+            for (int slot : {listed_tiles_slot, 1 - listed_tiles_slot}) {
+                GLsync& fence = listed_tiles_fences[slot];
+                if (!fence) {
+                    continue;
+                }
+                GLenum status = glClientWaitSync(fence, 0, 0);
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                    skipped_tiles = 1.f - float(listed_tiles[slot]) / listed_tiles_totals[slot];
+                    glDeleteSync(fence);
+                    fence = nullptr;
+                }
+            }
+            auto pos = state.cursor_pos * glm::vec2(buffer_size) / screen_size - screen_pos / 2.f;
+            if (timed) {
+                glBeginQuery(GL_TIME_ELAPSED, step_queries[step_query]);
+            }
+            for (int i = 0; i < dispatches; i++) {
+                step_dispatch(pos);
+            }
+            if (timed) {
+                glEndQuery(GL_TIME_ELAPSED);
+            }
+            // Skipped when both slots are still in flight
+            bool listed = skip_stable_tiles && !is_paused && !packed_storage;
+            if (listed && !listed_tiles_fences[listed_tiles_slot]) {
+                glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+                glCopyNamedBufferSubData(
+                    tile_dispatch, listed_tiles_buffer, 3 * sizeof(GLuint), listed_tiles_slot * sizeof(GLuint),
+                    sizeof(GLuint)
+                );
+                listed_tiles_fences[listed_tiles_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                listed_tiles_totals[listed_tiles_slot] = tile_count;
+                listed_tiles_slot = 1 - listed_tiles_slot;
+            }
+            if (timed) {
+                step_query_issued[step_query] = true;
+                step_query_dispatches[step_query] = dispatches;
+                step_query = 1 - step_query;
+            }
+            if (!is_paused) {
+                counted_generations += dispatches * per_dispatch;
+                generation += dispatches * per_dispatch;
+            }
         }
-        glUseProgram(display);
+        if (current_time - rate_window_start >= 0.5) {
+            achieved_rate = counted_generations / (current_time - rate_window_start);
+            counted_generations = 0;
+            rate_window_start = current_time;
+        }
+        profiler->end(PHASE_STEP);
+        profiler->begin(PHASE_DISPLAY);
+        glUseProgram(packed_storage ? packed_display : display);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        profiler->end(PHASE_DISPLAY);
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glViewport(0, 0, state.res.x, state.res.y);
 
+        profiler->begin(PHASE_UI_BUILD);
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -203,7 +987,7 @@ int main(int argc, const char* argv[]) {
                 ImGuiWindowFlags_NoTitleBar
         );
 
-        for (int i = 0; i < 9; i++) {
+        for (int i = 0; i < RULE_COUNT; i++) {
             if (i != 0) {
                 ImGui::SameLine();
             }
@@ -221,30 +1005,138 @@ int main(int argc, const char* argv[]) {
         }
         ImGui::SameLine();
         if (ImGui::Button("Regenerate")) {
-            image = getRandomImage(BUFFER_WIDTH, BUFFER_HEIGHT, 1.f - gen_proba);
-            replaceTexture(buffer1, BUFFER_WIDTH, BUFFER_HEIGHT, GL_R32F, GL_RED, GL_FLOAT, image.data());
+            soup_seed = std::random_device()() | uint64_t(std::random_device()()) << 32;
+            regenerate();
             update_rules();
         }
         ImGui::SameLine();
-        ImGui::InputInt("Framerate", &framerate);
+        if (ImGui::Checkbox("Specialize rules", &specialize_rules)) {
+            load_step_programs();
+            set_step_uniforms();
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Max speed", &max_speed);
+        if (!max_speed) {
+            ImGui::SameLine();
+            if (ImGui::InputInt("Generations/s", &generation_rate)) {
+                generation_rate = std::max(generation_rate, 1);
+            }
+        }
+        ImGui::SameLine();
+        ImGui::Text("%.0f gen/s, generation %llu", achieved_rate, (unsigned long long)generation);
 
         if (ImGui::Button(is_paused ? "Resume##pause" : "Pause##pause")) {
             is_paused = !is_paused;
         }
+        ImGui::SameLine();
+        ImGui::Checkbox("Copy back (legacy)", &legacy_copy);
+        ImGui::SameLine();
+        ImGui::Text("Step: %.3f ms for %d dispatches", step_time, step_query_dispatches[1 - step_query]);
+        ImGui::Checkbox("Shared memory kernel", &use_shared_memory);
+        ImGui::SameLine();
+        if (ImGui::SliderInt("Generations per dispatch", &temporal_steps, 1, MAX_TEMPORAL_STEPS)) {
+            temporal_steps = std::clamp(temporal_steps, 1, MAX_TEMPORAL_STEPS);
+            load_step_programs();
+            set_step_uniforms();
+            force_all_tiles = true;
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Skip stable tiles", &skip_stable_tiles);
+        if (skip_stable_tiles) {
+            ImGui::SameLine();
+            ImGui::Text("Skipped: %.1f%%", skipped_tiles * 100.f);
+        }
+        ImGui::SameLine();
+        bool cpu_lookup = lut_engine != nullptr;
+        if (ImGui::Checkbox("Step on the CPU (lookup table)", &cpu_lookup)) {
+            if (cpu_lookup) {
+                lut_engine = std::make_unique<LutEngine>(buffer_size.x, buffer_size.y);
+                lut_engine->setRules(rule_masks);
+            } else {
+                lut_engine.reset();
+            }
+        }
 
-        if (ImGui::Button("Open file")) {
-            file_path = openFile();
-            if (!file_path.empty()) {
-                auto image = loadImage(file_path);
-                replaceTexture(buffer1, BUFFER_WIDTH, BUFFER_HEIGHT, GL_R32F, GL_RED, GL_FLOAT, image.data());
+        bool loading = pattern_loading.valid() || image_streaming;
+        ImGui::BeginDisabled(loading);
+        if (ImGui::Button(loading ? "Loading..." : "Open file")) {
+            file_path = fileDialog(
+                "getopenfilename", "*.png *.jpg *.jpeg *.bmp *.tga *.pbm *.pgm *.ppm *.rle *.mc *.snap"
+            );
+            if (!file_path.empty() && !(file_path.ends_with(".snap") && open_snapshot(file_path)) &&
+                !open_image_stream(file_path)) {
+                pattern_loading = std::async(
+                    std::launch::async, loadPattern, file_path, buffer_size, max_size(), fit_to_image
+                );
             }
         }
+        ImGui::EndDisabled();
+        ImGui::SameLine();
+        if (ImGui::Button("Save pattern")) {
+            auto path = fileDialog("getsavefilename", "*.rle *.mc");
+            std::ofstream file(path, std::ios::binary);
+            if (path.ends_with(".mc") && file) {
+                BitGrid grid = get_grid();
+                HashLife life = macrocellStore();
+                life.loadGrid(grid, -grid.width() / 2, -grid.height() / 2);
+                writeMacrocell(file, life, rules);
+            } else if (!path.empty() && file) {
+                writeRle(file, get_grid(), rules);
+            }
+        }
+        ImGui::SameLine();
+        ImGui::BeginDisabled(snapshot_save.has_value());
+        if (ImGui::Button(snapshot_save ? "Saving..." : "Save snapshot")) {
+            auto path = fileDialog("getsavefilename", "*.snap");
+            if (!path.empty()) {
+                save_snapshot(path);
+            }
+        }
+        ImGui::EndDisabled();
+        ImGui::SameLine();
+        ImGui::Checkbox("Compress", &compress_snapshots);
+        ImGui::SameLine();
+        ImGui::Checkbox("Fit universe to image", &fit_to_image);
         if (!file_path.empty()) {
             ImGui::SameLine();
-            ImGui::Text("...%s", file_path.substr(file_path.length() - 64, 64).c_str());
+            ImGui::Text("...%s", file_path.substr(std::max<int>(0, int(file_path.length()) - 64)).c_str());
         }
 
         ImGui::SliderFloat("Generation probability", &gen_proba, 0.0f, 1.0f);
+        ImGui::SameLine();
+        ImGui::InputScalar("Seed", ImGuiDataType_U64, &soup_seed);
+        ImGui::SameLine();
+        // Streamed bands would land on top of the new cells
+        ImGui::BeginDisabled(image_streaming != nullptr);
+        if (ImGui::Button("Replay seed")) {
+            regenerate();
+            update_rules();
+        }
+        ImGui::EndDisabled();
+
+        ImGui::InputInt2("Universe size", &size_input.x);
+        ImGui::SameLine();
+        ImGui::BeginDisabled(image_streaming != nullptr);
+        if (ImGui::Button("Resize")) {
+            resize_keeping_cells(size_input, packed_storage);
+        }
+        ImGui::EndDisabled();
+        ImGui::SameLine();
+        ImGui::Text("(max %dx%d)", max_size().x, max_size().y);
+        bool packed = packed_storage;
+        // A pattern being loaded is sized for the current storage
+        ImGui::BeginDisabled(loading);
+        if (ImGui::Checkbox("Packed storage (32 cells per texel)", &packed)) {
+            resize_keeping_cells(buffer_size, packed);
+        }
+        ImGui::EndDisabled();
+
+        if (ImGui::CollapsingHeader("Profiler")) {
+            if (ImGui::Button("Dump profile") && !profiler->dump(PROFILE_FILE)) {
+                fprintf(stderr, "Could not write %s\n", PROFILE_FILE.c_str());
+            }
+            profiler->showUi();
+        }
 
         ImGui::Image((void*)(intptr_t)framebuffer_texture, ImVec2(FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT));
         auto pos = ImGui::GetItemRectMin();
@@ -253,17 +1145,43 @@ int main(int argc, const char* argv[]) {
         screen_size = glm::vec2(size.x, size.y);
 
         ImGui::End();
+        profiler->end(PHASE_UI_BUILD);
 
+        profiler->begin(PHASE_UI_RENDER);
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler->end(PHASE_UI_RENDER);
 
+        profiler->begin(PHASE_SWAP);
         glfwSwapBuffers(window);
+        profiler->end(PHASE_SWAP);
+        profiler->endFrame();
     } while (!glfwWindowShouldClose(window));
 
-    glDeleteProgram(compute);
-    glDeleteTextures(1, &buffer1);
-    glDeleteTextures(1, &buffer2);
+    glDeleteProgram(full_step.program);
+    glDeleteProgram(shared_step.program);
+    glDeleteProgram(tiled_step.program);
+    glDeleteProgram(tile_list);
+    glDeleteProgram(soups[0]);
+    glDeleteProgram(soups[1]);
+    glDeleteBuffers(1, &active_tiles);
+    glDeleteBuffers(2, changed_tiles);
+    glDeleteBuffers(1, &tile_dispatch);
+    for (GLsync fence : listed_tiles_fences) {
+        glDeleteSync(fence);
+    }
+    glUnmapNamedBuffer(listed_tiles_buffer);
+    glDeleteBuffers(1, &listed_tiles_buffer);
+    glDeleteTextures(2, buffers);
+    glDeleteQueries(2, step_queries);
     glDeleteProgram(display);
+    glDeleteProgram(packed_step.program);
+    glDeleteProgram(packed_display);
+    // The snapshot being written reads from a buffer mapped in this context
+    if (snapshot_save && snapshot_save->writing.valid()) {
+        snapshot_save->writing.wait();
+    }
+    profiler.reset();
     glfwDestroyWindow(window);
     // This segfaults for some reason
     // glfwTerminate();
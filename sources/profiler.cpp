@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <glad/glad.h>
+#include <imgui.h>
+
+#include "profiler.hpp"
+
+FrameProfiler::FrameProfiler(std::vector<std::string> phases) {
+    for (auto& name : phases) {
+        Phase phase;
+        phase.name = std::move(name);
+        glCreateQueries(GL_TIMESTAMP, 4, &phase.queries[0][0]);
+        _phases.push_back(std::move(phase));
+    }
+}
+
+FrameProfiler::~FrameProfiler() {
+    for (auto& phase : _phases) {
+        glDeleteQueries(4, &phase.queries[0][0]);
+    }
+}
+
+void FrameProfiler::beginFrame() {
+    // The set about to be reused was issued two frames ago, its results are read only if already there. Those still
+    // in flight are recorded as missing rather than as 0 ms, which would drag the percentiles down when the GPU lags.
+    int set = _frame % 2;
+    long frame = _frame - 2;
+    if (frame >= 0) {
+        for (auto& phase : _phases) {
+            float gpu_ms = 0;
+            GLint available = GL_FALSE;
+            if (phase.issued[set]) {
+                glGetQueryObjectiv(phase.queries[set][1], GL_QUERY_RESULT_AVAILABLE, &available);
+                gpu_ms = NAN;
+            }
+            if (available) {
+                GLuint64 start, end;
+                glGetQueryObjectui64v(phase.queries[set][0], GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(phase.queries[set][1], GL_QUERY_RESULT, &end);
+                gpu_ms = (end - start) / 1e6f;
+            }
+            phase.gpu_ms[frame % HISTORY] = gpu_ms;
+            phase.issued[set] = false;
+        }
+        _complete = frame + 1;
+    }
+    for (auto& phase : _phases) {
+        phase.cpu_ms[_frame % HISTORY] = 0;
+    }
+}
+
+void FrameProfiler::endFrame() {
+    _frame++;
+}
+
+void FrameProfiler::begin(int phase) {
+    Phase& p = _phases[phase];
+    glQueryCounter(p.queries[_frame % 2][0], GL_TIMESTAMP);
+    p.cpu_start = std::chrono::steady_clock::now();
+}
+
+void FrameProfiler::end(int phase) {
+    Phase& p = _phases[phase];
+    p.cpu_ms[_frame % HISTORY] =
+        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - p.cpu_start).count();
+    glQueryCounter(p.queries[_frame % 2][1], GL_TIMESTAMP);
+    p.issued[_frame % 2] = true;
+}
+
+std::vector<float> FrameProfiler::samples(const std::vector<float>& history) const {
+    std::vector<float> samples;
+    for (long frame = std::max(0L, _frame - HISTORY + 1); frame < _complete; frame++) {
+        if (!std::isnan(history[frame % HISTORY])) {
+            samples.push_back(history[frame % HISTORY]);
+        }
+    }
+    return samples;
+}
+
+void FrameProfiler::showUi() const {
+    auto percentile = [](std::vector<float> samples, float p) {
+        if (samples.empty()) {
+            return 0.f;
+        }
+        auto nth = samples.begin() + size_t(p * (samples.size() - 1));
+        std::nth_element(samples.begin(), nth, samples.end());
+        return *nth;
+    };
+    for (const auto& phase : _phases) {
+        auto cpu = samples(phase.cpu_ms);
+        auto gpu = samples(phase.gpu_ms);
+        auto cpu_label = std::format(
+            "{} CPU\np50 {:.3f} ms\np99 {:.3f} ms", phase.name, percentile(cpu, .5f), percentile(cpu, .99f)
+        );
+        auto gpu_label = std::format(
+            "{} GPU\np50 {:.3f} ms\np99 {:.3f} ms", phase.name, percentile(gpu, .5f), percentile(gpu, .99f)
+        );
+        ImGui::PlotHistogram(
+            std::format("##{}cpu", phase.name).c_str(), cpu.data(), int(cpu.size()), 0, nullptr, 0.f, 3.4e38f,
+            ImVec2(HISTORY, 40)
+        );
+        ImGui::SameLine();
+        ImGui::TextUnformatted(cpu_label.c_str());
+        ImGui::SameLine();
+        ImGui::PlotHistogram(
+            std::format("##{}gpu", phase.name).c_str(), gpu.data(), int(gpu.size()), 0, nullptr, 0.f, 3.4e38f,
+            ImVec2(HISTORY, 40)
+        );
+        ImGui::SameLine();
+        ImGui::TextUnformatted(gpu_label.c_str());
+    }
+}
+
+bool FrameProfiler::dump(const std::filesystem::path& file) const {
+    std::ofstream out(file);
+    if (!out) {
+        return false;
+    }
+    out << "frame";
+    for (const auto& phase : _phases) {
+        out << std::format(",{} cpu ms,{} gpu ms", phase.name, phase.name);
+    }
+    out << '\n';
+    for (long frame = std::max(0L, _frame - HISTORY + 1); frame < _complete; frame++) {
+        out << frame;
+        for (const auto& phase : _phases) {
+            // Missing GPU times are left empty
+            float gpu_ms = phase.gpu_ms[frame % HISTORY];
+            out << std::format(",{},", phase.cpu_ms[frame % HISTORY]);
+            if (!std::isnan(gpu_ms)) {
+                out << std::format("{}", gpu_ms);
+            }
+        }
+        out << '\n';
+    }
+    return bool(out);
+}
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gol/snapshot.hpp"
+
+namespace {
+
+// Offsets of the header fields the corrupted files change, as laid out by writeSnapshot()
+constexpr size_t TILE_ROWS_OFFSET = 12;
+constexpr size_t TILE_COUNT_OFFSET = 48;
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+std::vector<char> readFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::filesystem::path& path, const std::vector<char>& bytes) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+void patch32(std::vector<char>& bytes, size_t offset, uint32_t value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+bool rejected(const std::filesystem::path& path) {
+    try {
+        SnapshotFile snapshot(path.string());
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+// Writes a snapshot, reads it back, then checks that headers with a corrupted tile_rows are rejected
+int main() {
+    auto directory = std::filesystem::temp_directory_path();
+    auto valid = directory / "gol_snapshot_test.snap";
+    auto corrupt = directory / "gol_snapshot_test_corrupt.snap";
+
+    // Taller than one tile, so the file has a tile table of several entries
+    SnapshotInfo info;
+    info.width = 100;
+    info.height = SNAPSHOT_TILE_ROWS + 44;
+    BitGrid grid(info.width, info.height);
+    for (int y = 0; y < info.height; y++) {
+        grid.set((y * 7) % info.width, y, true);
+    }
+    writeSnapshot(valid.string(), info, grid.row(0), grid.stride(), true);
+    {
+        SnapshotFile snapshot(valid.string());
+        BitGrid read(info.width, info.height);
+        snapshot.readInto(read);
+        check(read.population() == grid.population(), "round trip population");
+    }
+
+    // A tile_rows above INT_MAX makes a single tile, consistent with tile_count, but would be a negative row count
+    std::vector<char> bytes = readFile(valid);
+    for (uint32_t tile_rows : {0x80000000u, 0x80000001u, 0xFFFFFFFFu}) {
+        std::vector<char> patched = bytes;
+        patch32(patched, TILE_ROWS_OFFSET, tile_rows);
+        patch32(patched, TILE_COUNT_OFFSET, 1);
+        writeFile(corrupt, patched);
+        check(rejected(corrupt), std::format("tile_rows {} rejected", tile_rows));
+    }
+    // Zero rows per tile cannot describe any universe
+    patch32(bytes, TILE_ROWS_OFFSET, 0);
+    writeFile(corrupt, bytes);
+    check(rejected(corrupt), "tile_rows 0 rejected");
+
+    std::filesystem::remove(valid);
+    std::filesystem::remove(corrupt);
+    if (failures == 0) {
+        std::cout << "snapshot: all checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}